@@ -0,0 +1,352 @@
+#include "BoardView.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <algorithm>
+
+BoardView::BoardView(int boardSize, QWidget *parent)
+    : QWidget(parent), cellsPerSide(0), interactive(true), dimmed(false), hoveredCell(-1), pressedCell(-1)
+{
+    setMouseTracking(true);
+    setCursor(Qt::PointingHandCursor);
+    setBoardSize(boardSize);
+}
+
+void BoardView::setBoardSize(int newSize)
+{
+    newSize = std::max(1, newSize);
+    if (newSize == cellsPerSide) {
+        return;
+    }
+
+    cellsPerSide = newSize;
+    board.assign(static_cast<size_t>(cellsPerSide * cellsPerSide), ' ');
+    hints.assign(board.size(), Hint());
+    hoveredCell = -1;
+    pressedCell = -1;
+
+    for (QPixmap& tile : tiles) {
+        tile = QPixmap();
+    }
+    update();
+}
+
+void BoardView::setColors(const Colors& newColors)
+{
+    colors = newColors;
+    for (QPixmap& tile : tiles) {
+        tile = QPixmap();
+    }
+    update();
+}
+
+void BoardView::setCell(int row, int col, char player)
+{
+    if (row < 0 || row >= cellsPerSide || col < 0 || col >= cellsPerSide) {
+        return;
+    }
+
+    int index = row * cellsPerSide + col;
+    if (board[index] == player) {
+        return;
+    }
+
+    board[index] = player;
+    updateCell(index);
+}
+
+char BoardView::cell(int row, int col) const
+{
+    if (row < 0 || row >= cellsPerSide || col < 0 || col >= cellsPerSide) {
+        return ' ';
+    }
+    return board[row * cellsPerSide + col];
+}
+
+void BoardView::clear()
+{
+    for (int i = 0; i < static_cast<int>(board.size()); i++) {
+        if (board[i] != ' ') {
+            board[i] = ' ';
+            updateCell(i);
+        }
+    }
+}
+
+void BoardView::setInteractive(bool enabled)
+{
+    if (interactive == enabled) {
+        return;
+    }
+
+    interactive = enabled;
+    if (!interactive) {
+        setHoveredCell(-1);
+        pressedCell = -1;
+    }
+    setCursor(interactive ? Qt::PointingHandCursor : Qt::ArrowCursor);
+}
+
+void BoardView::setDimmed(bool enabled)
+{
+    if (dimmed != enabled) {
+        dimmed = enabled;
+        update();
+    }
+}
+
+void BoardView::setCellHint(int row, int col, const QColor& color, const QString& label)
+{
+    if (row < 0 || row >= cellsPerSide || col < 0 || col >= cellsPerSide) {
+        return;
+    }
+
+    Hint& hint = hints[row * cellsPerSide + col];
+    if (hint.color == color && hint.label == label) {
+        return;
+    }
+
+    hint.color = color;
+    hint.label = label;
+    updateCell(row * cellsPerSide + col);
+}
+
+void BoardView::clearHints()
+{
+    for (int i = 0; i < static_cast<int>(hints.size()); i++) {
+        if (hints[i].color.isValid()) {
+            hints[i] = Hint();
+            updateCell(i);
+        }
+    }
+}
+
+QSize BoardView::sizeHint() const
+{
+    return QSize(320, 320);
+}
+
+// GEOMETRY
+
+int BoardView::cellSize() const
+{
+    int side = std::min(width(), height());
+    return std::max(1, (side - SPACING * (cellsPerSide - 1)) / cellsPerSide);
+}
+
+QRect BoardView::cellRect(int index) const
+{
+    int cellPx = cellSize();
+    int row = index / cellsPerSide;
+    int col = index % cellsPerSide;
+    return QRect(col * (cellPx + SPACING), row * (cellPx + SPACING), cellPx, cellPx);
+}
+
+int BoardView::cellAt(const QPoint& pos) const
+{
+    int step = cellSize() + SPACING;
+    int col = pos.x() / step;
+    int row = pos.y() / step;
+
+    if (pos.x() < 0 || pos.y() < 0 || row >= cellsPerSide || col >= cellsPerSide) {
+        return -1;
+    }
+
+    // Gaps between cells don't count
+    if (pos.x() % step >= cellSize() || pos.y() % step >= cellSize()) {
+        return -1;
+    }
+    return row * cellsPerSide + col;
+}
+
+void BoardView::updateCell(int index)
+{
+    update(cellRect(index));
+}
+
+// PAINTING
+
+BoardView::Tile BoardView::tileFor(int index) const
+{
+    if (board[index] == 'X') return TILE_X;
+    if (board[index] == 'O') return TILE_O;
+    if (index == pressedCell) return TILE_PRESSED;
+    if (index == hoveredCell) return TILE_HOVER;
+    return TILE_EMPTY;
+}
+
+const QPixmap& BoardView::tilePixmap(Tile tile)
+{
+    QPixmap& pixmap = tiles[tile];
+    if (pixmap.isNull()) {
+        renderTile(tile, pixmap);
+    }
+    return pixmap;
+}
+
+void BoardView::renderTile(Tile tile, QPixmap& pixmap) const
+{
+    int cellPx = cellSize();
+    qreal ratio = devicePixelRatioF();
+
+    pixmap = QPixmap(QSize(cellPx, cellPx) * ratio);
+    pixmap.setDevicePixelRatio(ratio);
+    pixmap.fill(Qt::transparent);
+
+    QColor fill = colors.emptyFill;
+    QColor border = colors.emptyBorder;
+    int borderWidth = 2;
+
+    switch (tile) {
+    case TILE_HOVER:
+        fill = colors.hoverFill;
+        border = colors.hoverBorder;
+        break;
+    case TILE_PRESSED:
+        fill = colors.pressedFill;
+        border = colors.hoverBorder;
+        break;
+    case TILE_X:
+        fill = colors.xFill;
+        border = colors.xBorder;
+        borderWidth = 3;
+        break;
+    case TILE_O:
+        fill = colors.oFill;
+        border = colors.oBorder;
+        borderWidth = 3;
+        break;
+    default:
+        break;
+    }
+
+    QPainter painter(&pixmap);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(QPen(border, borderWidth));
+    painter.setBrush(fill);
+
+    qreal inset = borderWidth / 2.0;
+    painter.drawRoundedRect(QRectF(inset, inset, cellPx - borderWidth, cellPx - borderWidth), 10, 10);
+
+    if (tile == TILE_X || tile == TILE_O) {
+        // 42px on the original 102px buttons
+        QFont font("Arial");
+        font.setBold(true);
+        font.setPixelSize(std::max(8, cellPx * 42 / 102));
+
+        QRect textRect(0, 0, cellPx, cellPx);
+        painter.setFont(font);
+        painter.setPen(QColor(0, 0, 0, 77));
+        painter.drawText(textRect.translated(1, 1), Qt::AlignCenter, tile == TILE_X ? "X" : "O");
+        painter.setPen(Qt::white);
+        painter.drawText(textRect, Qt::AlignCenter, tile == TILE_X ? "X" : "O");
+    }
+}
+
+void BoardView::paintHint(QPainter& painter, const QRect& rect, const Hint& hint) const
+{
+    painter.save();
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(hint.color);
+    painter.drawRoundedRect(QRectF(rect).adjusted(4, 4, -4, -4), 8, 8);
+
+    if (!hint.label.isEmpty()) {
+        QFont font("Arial");
+        font.setBold(true);
+        font.setPixelSize(std::max(8, rect.width() * 15 / 102));
+
+        QColor text = hint.color;
+        text.setAlpha(255);
+        painter.setFont(font);
+        painter.setPen(text.darker(200));
+        painter.drawText(rect, Qt::AlignCenter | Qt::TextWordWrap, hint.label);
+    }
+    painter.restore();
+}
+
+void BoardView::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    if (dimmed) {
+        painter.setOpacity(0.6);
+    }
+
+    // Only cells inside the dirty region are blitted
+    for (int i = 0; i < static_cast<int>(board.size()); i++) {
+        QRect rect = cellRect(i);
+        if (event->region().intersects(rect)) {
+            painter.drawPixmap(rect.topLeft(), tilePixmap(tileFor(i)));
+            if (board[i] == ' ' && hints[i].color.isValid()) {
+                paintHint(painter, rect, hints[i]);
+            }
+        }
+    }
+}
+
+void BoardView::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    for (QPixmap& tile : tiles) {
+        tile = QPixmap();
+    }
+}
+
+// INPUT
+
+void BoardView::setHoveredCell(int index)
+{
+    if (index == hoveredCell) {
+        return;
+    }
+
+    int previous = hoveredCell;
+    hoveredCell = index;
+
+    if (previous != -1) updateCell(previous);
+    if (index != -1) updateCell(index);
+}
+
+void BoardView::mouseMoveEvent(QMouseEvent *event)
+{
+    if (interactive) {
+        setHoveredCell(cellAt(event->position().toPoint()));
+    }
+    QWidget::mouseMoveEvent(event);
+}
+
+void BoardView::mousePressEvent(QMouseEvent *event)
+{
+    if (!interactive || event->button() != Qt::LeftButton) {
+        QWidget::mousePressEvent(event);
+        return;
+    }
+
+    pressedCell = cellAt(event->position().toPoint());
+    if (pressedCell != -1) {
+        updateCell(pressedCell);
+    }
+}
+
+void BoardView::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (!interactive || event->button() != Qt::LeftButton || pressedCell == -1) {
+        QWidget::mouseReleaseEvent(event);
+        return;
+    }
+
+    int pressed = pressedCell;
+    pressedCell = -1;
+    updateCell(pressed);
+
+    // Like a button: the click counts only if released over the same cell
+    if (cellAt(event->position().toPoint()) == pressed) {
+        emit cellClicked(pressed / cellsPerSide, pressed % cellsPerSide);
+    }
+}
+
+void BoardView::leaveEvent(QEvent *event)
+{
+    setHoveredCell(-1);
+    QWidget::leaveEvent(event);
+}
@@ -0,0 +1,115 @@
+#ifndef BOARDVIEW_H
+#define BOARDVIEW_H
+
+#include <QWidget>
+#include <QPixmap>
+#include <QColor>
+#include <QString>
+#include <vector>
+
+class QPainter;
+
+// N x N board painted with QPainter. Every tile (empty, hovered, pressed, X,
+// O) is rendered once into a pixmap per cell size, so a move blits one pixmap
+// and repaints only the rectangle of the cell that changed; nothing goes
+// through stylesheets.
+class BoardView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    struct Colors {
+        QColor emptyFill = QColor("#ffffff");
+        QColor emptyBorder = QColor("#adb5bd");
+        QColor hoverFill = QColor("#f1f3f4");
+        QColor hoverBorder = QColor("#007bff");
+        QColor pressedFill = QColor("#e2e6ea");
+        QColor xFill = QColor("#dc3545");
+        QColor xBorder = QColor("#c82333");
+        QColor oFill = QColor("#007bff");
+        QColor oBorder = QColor("#0056b3");
+    };
+
+    explicit BoardView(int boardSize = 3, QWidget *parent = nullptr);
+
+    void setBoardSize(int newSize);
+    int boardSize() const { return cellsPerSide; }
+
+    void setColors(const Colors& colors);
+
+    // player is 'X', 'O' or ' '; unchanged cells are not repainted
+    void setCell(int row, int col, char player);
+    char cell(int row, int col) const;
+    void clear();
+
+    // Row-major contents, boardSize() * boardSize() chars
+    const std::vector<char>& cells() const { return board; }
+
+    // Hover/click feedback and cellClicked; off for read-only boards
+    void setInteractive(bool interactive);
+    bool isInteractive() const { return interactive; }
+
+    // Faded look for a finished game
+    void setDimmed(bool dimmed);
+
+    // Tint and short caption over an empty cell, e.g. a move heatmap. Painted
+    // on top of the tiles, so it leaves the tile cache alone; an invalid
+    // color removes it.
+    void setCellHint(int row, int col, const QColor& color, const QString& label = QString());
+    void clearHints();
+
+    QSize sizeHint() const override;
+
+signals:
+    void cellClicked(int row, int col);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void leaveEvent(QEvent *event) override;
+
+private:
+    enum Tile {
+        TILE_EMPTY = 0,
+        TILE_HOVER,
+        TILE_PRESSED,
+        TILE_X,
+        TILE_O,
+        TILE_COUNT
+    };
+
+    struct Hint {
+        QColor color;
+        QString label;
+    };
+
+    static const int SPACING = 5;
+
+    int cellSize() const;
+    QRect cellRect(int index) const;
+    int cellAt(const QPoint& pos) const;
+    Tile tileFor(int index) const;
+    const QPixmap& tilePixmap(Tile tile);
+    void renderTile(Tile tile, QPixmap& pixmap) const;
+    void paintHint(QPainter& painter, const QRect& rect, const Hint& hint) const;
+    void updateCell(int index);
+    void setHoveredCell(int index);
+
+    int cellsPerSide; // Rows and columns
+    std::vector<char> board;
+    std::vector<Hint> hints;
+    Colors colors;
+
+    bool interactive;
+    bool dimmed;
+    int hoveredCell;
+    int pressedCell;
+
+    // Rendered tiles for the current cell size; dropped on resize
+    QPixmap tiles[TILE_COUNT];
+};
+
+#endif // BOARDVIEW_H
@@ -0,0 +1,30 @@
+#include "Diagnostics.h"
+#include <atomic>
+#include <cstdlib>
+#include <string>
+
+namespace Diagnostics {
+
+namespace {
+
+bool fromEnvironment() {
+    const char* setting = std::getenv("TICTACTOE_DIAGNOSTICS");
+    return setting && *setting && std::string(setting) != "0";
+}
+
+std::atomic<bool>& flag() {
+    static std::atomic<bool> on{fromEnvironment()};
+    return on;
+}
+
+}
+
+bool enabled() {
+    return flag();
+}
+
+void enable() {
+    flag() = true;
+}
+
+}
@@ -0,0 +1,15 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+// Switch for the reports meant for whoever is tuning the game rather than
+// playing it: write queue waits at exit, maintenance passes as they run.
+// Off unless the GUI is started with --diagnostics or
+// $TICTACTOE_DIAGNOSTICS is set (to anything but 0). Thread safe.
+namespace Diagnostics {
+
+bool enabled();
+void enable();
+
+}
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,134 @@
+#include "GameArchive.h"
+#include "MoveCodec.h"
+#include <cstdlib>
+
+namespace GameArchive {
+
+// FIELDS
+
+static void appendField(std::string& line, const std::string& field) {
+    if (!line.empty()) {
+        line += '\t';
+    }
+    for (char c : field) {
+        switch (c) {
+        case '\\': line += "\\\\"; break;
+        case '\t': line += "\\t"; break;
+        case '\n': line += "\\n"; break;
+        case '\r': line += "\\r"; break;
+        default: line += c; break;
+        }
+    }
+}
+
+static std::vector<std::string> splitFields(const std::string& line) {
+    std::vector<std::string> fields(1);
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (c == '\t') {
+            fields.emplace_back();
+        } else if (c == '\\' && i + 1 < line.size()) {
+            char next = line[++i];
+            fields.back() += next == 't' ? '\t' : next == 'n' ? '\n' : next == 'r' ? '\r' : next;
+        } else if (c != '\r') {
+            fields.back() += c;
+        }
+    }
+    return fields;
+}
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+static std::string toHex(const std::vector<uint8_t>& bytes) {
+    std::string hex;
+    hex.reserve(bytes.size() * 2);
+    for (uint8_t byte : bytes) {
+        hex += HEX_DIGITS[byte >> 4];
+        hex += HEX_DIGITS[byte & 0xF];
+    }
+    return hex;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool fromHex(const std::string& hex, std::vector<uint8_t>& bytes) {
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+
+    bytes.clear();
+    bytes.reserve(hex.size() / 2);
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        int high = hexValue(hex[i]);
+        int low = hexValue(hex[i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        bytes.push_back(static_cast<uint8_t>(high << 4 | low));
+    }
+    return true;
+}
+
+// RECORDS
+
+std::string formatUser(const UserLine& user) {
+    std::string line = "U";
+    appendField(line, user.username);
+    appendField(line, user.passwordHash);
+    appendField(line, user.createdAt);
+    return line;
+}
+
+std::string formatGame(const GameLine& game) {
+    std::string line = "G";
+    appendField(line, game.timestamp);
+    appendField(line, game.player1);
+    appendField(line, game.player2);
+    appendField(line, std::string(1, game.winner));
+    appendField(line, game.gameMode);
+    appendField(line, std::to_string(game.plyCount));
+    appendField(line, toHex(game.moveData));
+    return line;
+}
+
+LineType parseLine(const std::string& line, UserLine& user, GameLine& game) {
+    if (line.empty() || line[0] == '#' || line == "\r") {
+        return SKIPPED_LINE;
+    }
+
+    std::vector<std::string> fields = splitFields(line);
+
+    if (fields[0] == "U" && fields.size() == 4 && !fields[1].empty() && !fields[2].empty()) {
+        user.username = fields[1];
+        user.passwordHash = fields[2];
+        user.createdAt = fields[3];
+        return USER_LINE;
+    }
+
+    if (fields[0] == "G" && fields.size() == 8 && !fields[2].empty() && fields[4].size() == 1) {
+        game.timestamp = fields[1];
+        game.player1 = fields[2];
+        game.player2 = fields[3];
+        game.winner = fields[4][0];
+        game.gameMode = fields[5];
+
+        char* end = nullptr;
+        game.plyCount = static_cast<int>(std::strtol(fields[6].c_str(), &end, 10));
+        bool validWinner = game.winner == '1' || game.winner == '2' || game.winner == 'A' || game.winner == '-';
+
+        // The move blob has to decode to exactly the stated number of plies
+        if (validWinner && !fields[6].empty() && *end == '\0' && fromHex(fields[7], game.moveData) &&
+            MoveCodec::MoveView(game.moveData).plyCount() == game.plyCount) {
+            return GAME_LINE;
+        }
+    }
+
+    return INVALID_LINE;
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef GAMEARCHIVE_H
+#define GAMEARCHIVE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Line-oriented archive used to move games between databases.
+//
+// The first line is HEADER. Every other line is one record of tab separated
+// fields; tabs, newlines and backslashes inside a field are escaped with a
+// backslash. Players are referred to by username, so archives from
+// different databases can be merged even though their user ids differ.
+//
+//   U <username> <password_hash> <created_at>
+//   G <timestamp> <player1> <player2> <winner> <game_mode> <plies> <moves>
+//
+// <player2> is empty for games against the AI or a guest. <winner> is 1 or
+// 2 for a player, A for the AI and - for a draw. <moves> is the MoveCodec
+// encoding in hex. Lines starting with '#' are comments.
+namespace GameArchive {
+
+const char* const HEADER = "#tictactoe-archive 1";
+
+struct UserLine {
+    std::string username;
+    std::string passwordHash;
+    std::string createdAt;
+};
+
+struct GameLine {
+    std::string timestamp;
+    std::string player1;
+    std::string player2;
+    char winner = '-';
+    std::string gameMode;
+    int plyCount = 0;
+    std::vector<uint8_t> moveData;
+};
+
+enum LineType {
+    INVALID_LINE,
+    SKIPPED_LINE, // Blank or comment
+    USER_LINE,
+    GAME_LINE
+};
+
+std::string formatUser(const UserLine& user);
+std::string formatGame(const GameLine& game);
+
+// Fills whichever record the line holds
+LineType parseLine(const std::string& line, UserLine& user, GameLine& game);
+
+}
+
+#endif // GAMEARCHIVE_H
@@ -0,0 +1,58 @@
+#include "GameHistoryDelegate.h"
+#include "GameHistoryModel.h"
+#include <QPainter>
+
+GameHistoryDelegate::GameHistoryDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+    titleFont.setFamily("Segoe UI");
+    titleFont.setPixelSize(14);
+
+    dateFont = titleFont;
+    dateFont.setPixelSize(12);
+}
+
+void GameHistoryDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    painter->save();
+
+    QRect rect = option.rect;
+    bool selected = option.state & QStyle::State_Selected;
+    bool hovered = option.state & QStyle::State_MouseOver;
+
+    // Same palette as the former QListWidget stylesheet
+    if (selected) {
+        painter->fillRect(rect, QColor("#4A90E2"));
+    } else if (hovered) {
+        painter->fillRect(rect, QColor(74, 144, 226, 25));
+    }
+
+    painter->setPen(QColor("#e9ecef"));
+    painter->drawLine(rect.bottomLeft(), rect.bottomRight());
+
+    QRect textRect = rect.adjusted(8, 0, -8, 0);
+    QString date = index.data(GameHistoryModel::TimestampRole).toString();
+
+    painter->setFont(dateFont);
+    painter->setPen(selected ? QColor(Qt::white) : QColor("#6c757d"));
+    painter->drawText(textRect, Qt::AlignRight | Qt::AlignVCenter, date);
+
+    int dateWidth = painter->fontMetrics().horizontalAdvance(date) + 12;
+    textRect.setRight(textRect.right() - dateWidth);
+
+    QFont font = titleFont;
+    font.setBold(selected);
+    painter->setFont(font);
+    painter->setPen(selected ? QColor(Qt::white) : index.data(Qt::ForegroundRole).value<QColor>());
+    painter->drawText(textRect, Qt::AlignLeft | Qt::AlignVCenter,
+                      painter->fontMetrics().elidedText(index.data(Qt::DisplayRole).toString(),
+                                                        Qt::ElideRight, textRect.width()));
+
+    painter->restore();
+}
+
+QSize GameHistoryDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    Q_UNUSED(index);
+    return QSize(option.rect.width(), 36);
+}
@@ -0,0 +1,24 @@
+#ifndef GAMEHISTORYDELEGATE_H
+#define GAMEHISTORYDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QFont>
+
+// Paints GameHistoryModel rows directly: no per-row widgets or stylesheet
+// polishing, and a fixed row height so the view can skip measuring rows.
+class GameHistoryDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit GameHistoryDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+private:
+    QFont titleFont;
+    QFont dateFont;
+};
+
+#endif // GAMEHISTORYDELEGATE_H
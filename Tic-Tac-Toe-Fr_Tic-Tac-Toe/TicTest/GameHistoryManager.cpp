@@ -1,7 +1,48 @@
 #include "GameHistoryManager.h"
 #include <iostream>
 
-GameHistoryManager::GameHistoryManager() : database(nullptr), currentPlayer1Id(-1), currentPlayer2Id(-1) {
+// GAME RECORDER
+
+GameRecorder::GameRecorder(GameHistoryManager* owner, int session, const std::string& mode, int player1, int player2)
+    : owner(owner), session(session), mode(mode), player1(player1), player2(player2), saved(false),
+      incomplete(false) {
+}
+
+bool GameRecorder::recordMove(char player, int row, int col) {
+    if (saved) {
+        return false;
+    }
+
+    if (!encoder.append(player, row, col)) {
+        std::cerr << "Move " << player << row << col << " not recorded for game session " << session << std::endl;
+        incomplete = true;
+        return false;
+    }
+
+    journal.append(player, row, col);
+    return true;
+}
+
+bool GameRecorder::saveResult(int winnerId) {
+    if (saved || player1 == -1) {
+        return false;
+    }
+
+    if (incomplete) {
+        std::cerr << "Game session " << session << " is missing moves and was not saved" << std::endl;
+        return false;
+    }
+
+    saved = owner->persist(*this, winnerId);
+    if (saved) {
+        journal.discard();
+    }
+    return saved;
+}
+
+// SESSION REGISTRY
+
+GameHistoryManager::GameHistoryManager() : database(nullptr), nextSessionId(1) {
     try {
         database = new TicTacToeDB();
     } catch (const std::exception& e) {
@@ -13,39 +54,56 @@ GameHistoryManager::~GameHistoryManager() {
     delete database;
 }
 
-void GameHistoryManager::startNewGame(const std::string& gameMode, int player1Id, int player2Id) {
-    currentGameMoves.clear();
-    currentGameMode = gameMode;
-    currentPlayer1Id = player1Id;
-    currentPlayer2Id = player2Id;
-}
+GameRecorder* GameHistoryManager::startGame(const std::string& gameMode, int player1Id, int player2Id) {
+    std::unique_lock<std::mutex> lock(sessionMutex);
+    int session = nextSessionId++;
+    lock.unlock();
+
+    std::unique_ptr<GameRecorder> recorder(new GameRecorder(this, session, gameMode, player1Id, player2Id));
+
+    // Journal failures only cost crash recovery, never the game itself
+    recorder->journal.open(session, gameMode, player1Id, player2Id);
 
-void GameHistoryManager::recordMove(char player, int row, int col) {
-    std::string move = formatMove(player, row, col);
-    currentGameMoves.push_back(move);
+    GameRecorder* handle = recorder.get();
+    lock.lock();
+    sessions[session] = std::move(recorder);
+    return handle;
 }
 
-void GameHistoryManager::saveGameResult(int winnerId) {
-    if (!database || currentPlayer1Id == -1) {
+void GameHistoryManager::endGame(GameRecorder* recorder) {
+    if (!recorder) {
         return;
     }
 
-    try {
-        database->saveGame(currentPlayer1Id, currentPlayer2Id, winnerId, currentGameMoves, currentGameMode);
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to save game: " << e.what() << std::endl;
-    }
+    // Ended on purpose (new game, window closed), so nothing to recover
+    recorder->journal.discard();
+
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    sessions.erase(recorder->sessionId());
 }
 
-void GameHistoryManager::clearCurrentGame() {
-    currentGameMoves.clear();
-    currentGameMode = "";
-    currentPlayer1Id = -1;
-    currentPlayer2Id = -1;
+int GameHistoryManager::activeGameCount() const {
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    return static_cast<int>(sessions.size());
 }
 
-std::string GameHistoryManager::formatMove(char player, int row, int col) {
-    return std::string(1, player) + std::to_string(row) + std::to_string(col);
+bool GameHistoryManager::persist(const GameRecorder& recorder, int winnerId) {
+    if (!database) {
+        return false;
+    }
+
+    const auto& bytes = recorder.encoder.bytes();
+    std::vector<uint8_t> moveData(bytes.data(), bytes.data() + bytes.size());
+
+    std::lock_guard<std::mutex> lock(databaseMutex);
+    try {
+        database->saveGame(recorder.player1, recorder.player2, winnerId, moveData,
+                           recorder.plyCount(), recorder.mode);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to save game: " << e.what() << std::endl;
+        return false;
+    }
 }
 
 GameHistoryManager* GameHistoryManager::getInstance() {
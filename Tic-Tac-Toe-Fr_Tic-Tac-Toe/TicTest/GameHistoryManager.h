@@ -1,28 +1,84 @@
 #ifndef GAMEHISTORYMANAGER_H
 #define GAMEHISTORYMANAGER_H
 
-#include <vector>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include "GameJournal.h"
+#include "MoveCodec.h"
 #include "TicTacToeDB.h"
 
+class GameHistoryManager;
+
+// Records one game. Each GameWindow owns its own handle, so moves go into
+// the recorder's inline buffer with no locking and no allocation; only
+// saveResult() reaches the shared database. Every move is also written to
+// the game's crash journal, which is removed once the game is saved or
+// ended on purpose.
+class GameRecorder {
+public:
+    // Generous for Overwrite mode, where games have no fixed length; longer
+    // games move to the heap once
+    static const int MAX_MOVE_BYTES = 128;
+
+    int sessionId() const { return session; }
+    const std::string& gameMode() const { return mode; }
+    int player1Id() const { return player1; }
+    int player2Id() const { return player2; }
+
+    // False if the move breaks turn order; the game is then incomplete
+    bool recordMove(char player, int row, int col);
+
+    MoveCodec::MoveView moves() const { return encoder.view(); }
+    int plyCount() const { return encoder.plyCount(); }
+    bool isSaved() const { return saved; }
+    bool isIncomplete() const { return incomplete; }
+
+    // Persists the game once; later calls are ignored. An incomplete game is
+    // never saved, since its result would not follow from its moves.
+    bool saveResult(int winnerId);
+
+private:
+    friend class GameHistoryManager;
+
+    GameRecorder(GameHistoryManager* owner, int session, const std::string& mode, int player1, int player2);
+
+    GameHistoryManager* owner;
+    int session;
+    std::string mode;
+    int player1;
+    int player2;
+    bool saved;
+    bool incomplete; // A move was refused
+    MoveCodec::InlineEncoder<MAX_MOVE_BYTES> encoder;
+    GameJournal journal;
+};
+
+// Registry of the games in progress in this process. Starting and ending a
+// game takes the registry lock; persisting takes the database lock.
 class GameHistoryManager {
 private:
     TicTacToeDB* database;
-    std::vector<std::string> currentGameMoves;
-    std::string currentGameMode;
-    int currentPlayer1Id;
-    int currentPlayer2Id;
+    std::mutex databaseMutex;
+
+    mutable std::mutex sessionMutex;
+    std::unordered_map<int, std::unique_ptr<GameRecorder>> sessions;
+    int nextSessionId;
+
+    friend class GameRecorder;
+    bool persist(const GameRecorder& recorder, int winnerId);
 
 public:
     GameHistoryManager();
     ~GameHistoryManager();
 
-    void startNewGame(const std::string& gameMode, int player1Id, int player2Id = -1);
-    void recordMove(char player, int row, int col);
-    void saveGameResult(int winnerId);
-    void clearCurrentGame();
+    // The handle stays valid until endGame()
+    GameRecorder* startGame(const std::string& gameMode, int player1Id, int player2Id = -1);
+    void endGame(GameRecorder* recorder);
+
+    int activeGameCount() const;
 
-    static std::string formatMove(char player, int row, int col);
     static GameHistoryManager* getInstance();
 };
 
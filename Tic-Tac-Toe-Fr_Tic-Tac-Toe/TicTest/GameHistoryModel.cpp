@@ -0,0 +1,215 @@
+#include "GameHistoryModel.h"
+#include <QColor>
+#include <algorithm>
+
+GameHistoryModel::GameHistoryModel(QObject *parent)
+    : QAbstractListModel(parent), generation(0), hasMore(false), fetching(false), totalRows(0)
+{
+    query.pageSize = PAGE_SIZE;
+
+    refillTimer.setSingleShot(true);
+    refillTimer.setInterval(0);
+    connect(&refillTimer, &QTimer::timeout, this, &GameHistoryModel::requestMissingPages);
+}
+
+void GameHistoryModel::setFilter(int userId, const std::string& gameMode, TicTacToeDB::ResultFilter result,
+                                 int positionKey)
+{
+    query.userId = userId;
+    query.gameMode = gameMode;
+    query.result = result;
+    query.positionKey = positionKey;
+    reload();
+}
+
+void GameHistoryModel::reload()
+{
+    beginResetModel();
+    generation++;
+    pageStarts.clear();
+    pageOrder.clear();
+    pageCache.clear();
+    pendingPages.clear();
+    missingPages.clear();
+    refillTimer.stop();
+    nextCursor = TicTacToeDB::HistoryCursor();
+    hasMore = query.userId != -1;
+    fetching = false;
+    totalRows = 0;
+    endResetModel();
+
+    // Ask for the first page right away so an empty history is known early
+    fetchMore(QModelIndex());
+}
+
+int GameHistoryModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : totalRows;
+}
+
+bool GameHistoryModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && hasMore && !fetching;
+}
+
+void GameHistoryModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent)) {
+        return;
+    }
+
+    TicTacToeDB::HistoryQuery pageQuery = query;
+    pageQuery.after = nextCursor;
+
+    fetching = true;
+    emit pageRequested(generation, static_cast<int>(pageStarts.size()), pageQuery);
+}
+
+void GameHistoryModel::applyPage(int pageGeneration, int pageIndex, const TicTacToeDB::HistoryPage& page)
+{
+    // Results for a previous filter are simply dropped
+    if (pageGeneration != generation) {
+        return;
+    }
+
+    std::vector<TicTacToeDB::GameRecord> rows = page.games;
+    int count = static_cast<int>(rows.size());
+
+    if (pageIndex == static_cast<int>(pageStarts.size())) {
+        // Next page at the end of the list
+        fetching = false;
+        hasMore = page.hasMore;
+
+        if (count > 0) {
+            beginInsertRows(QModelIndex(), totalRows, totalRows + count - 1);
+            pageStarts.push_back(nextCursor);
+            nextCursor = page.next;
+            totalRows += count;
+            cachePage(pageIndex, std::move(rows));
+            endInsertRows();
+        }
+    } else if (pendingPages.erase(pageIndex)) {
+        // Refill of a page that had been evicted
+        int first = pageIndex * PAGE_SIZE;
+        int last = std::min(first + PAGE_SIZE, totalRows) - 1;
+        cachePage(pageIndex, std::move(rows));
+        emit dataChanged(index(first), index(last));
+    }
+
+    emit pageApplied();
+}
+
+const std::vector<TicTacToeDB::GameRecord>* GameHistoryModel::pageRows(int pageIndex) const
+{
+    if (pageIndex < 0 || pageIndex >= static_cast<int>(pageStarts.size())) {
+        return nullptr;
+    }
+
+    auto it = pageCache.find(pageIndex);
+    if (it != pageCache.end()) {
+        pageOrder.remove(pageIndex);
+        pageOrder.push_front(pageIndex);
+        return &it->second;
+    }
+
+    // Evicted earlier; asked for again once back in the event loop
+    if (!pendingPages.count(pageIndex) && missingPages.insert(pageIndex).second) {
+        refillTimer.start();
+    }
+
+    return nullptr;
+}
+
+void GameHistoryModel::requestMissingPages()
+{
+    // Each from its start cursor; a page already on its way is not asked twice
+    for (int pageIndex : missingPages) {
+        if (pendingPages.insert(pageIndex).second) {
+            TicTacToeDB::HistoryQuery pageQuery = query;
+            pageQuery.after = pageStarts[pageIndex];
+            emit pageRequested(generation, pageIndex, pageQuery);
+        }
+    }
+    missingPages.clear();
+}
+
+void GameHistoryModel::cachePage(int pageIndex, std::vector<TicTacToeDB::GameRecord>&& rows) const
+{
+    pageCache[pageIndex] = std::move(rows);
+    pageOrder.remove(pageIndex);
+    pageOrder.push_front(pageIndex);
+
+    while (static_cast<int>(pageOrder.size()) > MAX_CACHED_PAGES) {
+        pageCache.erase(pageOrder.back());
+        pageOrder.pop_back();
+    }
+}
+
+const TicTacToeDB::GameRecord* GameHistoryModel::recordAt(int row) const
+{
+    // The pointer stays valid until the next call that may evict its page
+    const std::vector<TicTacToeDB::GameRecord>* rows = pageRows(row / PAGE_SIZE);
+    size_t offset = static_cast<size_t>(row % PAGE_SIZE);
+
+    if (!rows || row < 0 || offset >= rows->size()) {
+        return nullptr;
+    }
+    return &(*rows)[offset];
+}
+
+QString GameHistoryModel::describeGame(const TicTacToeDB::GameRecord& game) const
+{
+    QString gameMode = QString::fromStdString(game.gameMode);
+
+    // Names come joined with the row; no per-game lookups
+    QString currentUserName = QString::fromStdString(
+        game.player1Id == query.userId ? game.player1Name : game.player2Name);
+
+    // Format opponent name based on game mode
+    if (gameMode.contains("AI")) {
+        QString aiLevel;
+        if (gameMode == "AI Easy") aiLevel = "Easy";
+        else if (gameMode == "AI Medium") aiLevel = "Medium";
+        else if (gameMode == "AI Hard") aiLevel = "Hard";
+        else aiLevel = "AI";
+
+        return QString("%1 vs AI (%2)").arg(currentUserName).arg(aiLevel);
+    }
+
+    return QString("%1 vs Guest (%2)").arg(currentUserName).arg(gameMode);
+}
+
+QVariant GameHistoryModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= totalRows) {
+        return QVariant();
+    }
+
+    const TicTacToeDB::GameRecord* game = recordAt(index.row());
+    if (!game) {
+        // Page is being re-read; it repaints through dataChanged
+        return role == Qt::DisplayRole ? QVariant(QString("Loading...")) : QVariant();
+    }
+
+    GameResult result = game->winner == 0 ? RESULT_DRAW :
+                            game->winner == query.userId ? RESULT_WIN : RESULT_LOSS;
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString("%1 - %2")
+            .arg(describeGame(*game))
+            .arg(result == RESULT_DRAW ? "Draw" : result == RESULT_WIN ? "Win" : "Loss");
+    case Qt::ForegroundRole:
+        // Orange for draws, green for wins, red for losses
+        return QColor(result == RESULT_DRAW ? "#fd7e14" :
+                          result == RESULT_WIN ? "#28a745" : "#dc3545");
+    case GameIdRole:
+        return game->id;
+    case ResultRole:
+        return static_cast<int>(result);
+    case TimestampRole:
+        return QString::fromStdString(game->timestamp).left(10);
+    default:
+        return QVariant();
+    }
+}
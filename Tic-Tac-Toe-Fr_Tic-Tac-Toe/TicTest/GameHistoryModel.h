@@ -0,0 +1,86 @@
+#ifndef GAMEHISTORYMODEL_H
+#define GAMEHISTORYMODEL_H
+
+#include <QAbstractListModel>
+#include <QTimer>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "TicTacToeDB.h"
+
+// List model over TicTacToeDB::queryGameHistory. Rows are fetched a page at
+// a time as the view scrolls, and only the most recently used pages are kept
+// in memory; evicted pages are re-read from their stored cursor on demand.
+//
+// The model never touches the database itself: it emits pageRequested and is
+// fed through applyPage, so the queries can run on a worker thread.
+class GameHistoryModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        GameIdRole = Qt::UserRole,
+        ResultRole,
+        TimestampRole
+    };
+
+    enum GameResult {
+        RESULT_DRAW = 0,
+        RESULT_WIN = 1,
+        RESULT_LOSS = 2
+    };
+
+    explicit GameHistoryModel(QObject *parent = nullptr);
+
+    void setFilter(int userId, const std::string& gameMode, TicTacToeDB::ResultFilter result,
+                   int positionKey = -1);
+    void reload();
+
+    const TicTacToeDB::GameRecord* recordAt(int row) const;
+    bool isEmpty() const { return totalRows == 0 && !hasMore && !fetching; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    static const int PAGE_SIZE = 100;
+    static const int MAX_CACHED_PAGES = 8;
+
+public slots:
+    void applyPage(int generation, int pageIndex, const TicTacToeDB::HistoryPage& page);
+
+signals:
+    void pageRequested(int generation, int pageIndex, const TicTacToeDB::HistoryQuery& query);
+    void pageApplied();
+
+private:
+    const std::vector<TicTacToeDB::GameRecord>* pageRows(int pageIndex) const;
+    void requestMissingPages();
+    void cachePage(int pageIndex, std::vector<TicTacToeDB::GameRecord>&& rows) const;
+    QString describeGame(const TicTacToeDB::GameRecord& game) const;
+
+    TicTacToeDB::HistoryQuery query;
+    int generation;
+
+    // Start cursor of every page fetched so far; enough to re-read any of them
+    std::vector<TicTacToeDB::HistoryCursor> pageStarts;
+    TicTacToeDB::HistoryCursor nextCursor;
+    bool hasMore;
+    bool fetching;
+    int totalRows;
+
+    // LRU page cache, most recent at the front
+    mutable std::list<int> pageOrder;
+    mutable std::unordered_map<int, std::vector<TicTacToeDB::GameRecord>> pageCache;
+    mutable std::unordered_set<int> pendingPages; // Requested, not applied yet
+
+    // Evicted pages data() came across; requested from the event loop,
+    // since a const read must not emit
+    mutable std::unordered_set<int> missingPages;
+    mutable QTimer refillTimer;
+};
+
+#endif // GAMEHISTORYMODEL_H
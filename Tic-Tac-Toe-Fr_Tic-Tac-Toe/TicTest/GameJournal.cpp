@@ -0,0 +1,272 @@
+#include "GameJournal.h"
+#include "MoveCodec.h"
+#include "TicTacToeDB.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+namespace {
+const char JOURNAL_MAGIC[4] = {'T', 'T', 'T', 'J'};
+const uint16_t JOURNAL_VERSION = 1;
+}
+
+GameJournal::GameJournal() : mapped(nullptr), nonce(0), records(0), capacity(0) {
+}
+
+GameJournal::~GameJournal() {
+    // Deliberately left on disk unless discard() was called
+    if (mapped) {
+        file.unmap(mapped);
+    }
+}
+
+QString GameJournal::directory() {
+    // Next to the database file. A memory database ends with the process,
+    // so there is nothing to recover a game into and no journal is kept.
+    std::string database = TicTacToeDB::filePath(TicTacToeDB::location());
+    if (database.empty()) {
+        return QString();
+    }
+    return QFileInfo(QString::fromStdString(database)).absoluteDir().filePath("journal");
+}
+
+bool GameJournal::open(int sessionId, const std::string& gameMode, int player1Id, int player2Id) {
+    discard();
+
+    QString path = directory();
+    if (path.isEmpty()) {
+        return false;
+    }
+
+    QDir dir(path);
+    if (!dir.exists() && !dir.mkpath(".")) {
+        std::cerr << "Cannot create journal directory" << std::endl;
+        return false;
+    }
+
+    QString name = QString("%1-%2-%3.journal")
+                       .arg(QDateTime::currentMSecsSinceEpoch())
+                       .arg(QCoreApplication::applicationPid())
+                       .arg(sessionId);
+    file.setFileName(dir.filePath(name));
+
+    // Only ever given up when the process ends or the game is discarded
+    lock.reset(new QLockFile(lockPath(file.fileName())));
+    lock->setStaleLockTime(0);
+    if (!lock->tryLock(0)) {
+        std::cerr << "Cannot lock game journal" << std::endl;
+        lock.reset();
+        return false;
+    }
+
+    qint64 size = static_cast<qint64>(sizeof(Header) + INITIAL_RECORDS * sizeof(Record));
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate) || !file.resize(size)) {
+        std::cerr << "Cannot create game journal: " << file.errorString().toStdString() << std::endl;
+        file.close();
+        lock.reset();
+        return false;
+    }
+
+    mapped = file.map(0, size);
+    if (!mapped) {
+        std::cerr << "Cannot map game journal: " << file.errorString().toStdString() << std::endl;
+        file.close();
+        file.remove();
+        lock.reset();
+        return false;
+    }
+
+    nonce = QRandomGenerator::global()->generate();
+    records = 0;
+    capacity = INITIAL_RECORDS;
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    header.recordSize = sizeof(Record);
+    header.player1Id = player1Id;
+    header.player2Id = player2Id;
+    header.nonce = nonce;
+    std::strncpy(header.gameMode, gameMode.c_str(), sizeof(header.gameMode) - 1);
+    header.checksum = headerChecksum(header);
+
+    std::memcpy(mapped, &header, sizeof(header));
+    return true;
+}
+
+void GameJournal::append(char player, int row, int col) {
+    if (!mapped) {
+        return;
+    }
+    if (records == capacity && !grow()) {
+        // Resuming from a journal that stops short would replay a different
+        // game, so without room for every move there is no journal at all
+        std::cerr << "Game journal full, no longer kept for this game" << std::endl;
+        discard();
+        return;
+    }
+
+    Record record;
+    record.sequence = static_cast<uint16_t>(records + 1);
+    record.cell = static_cast<uint8_t>(row * 3 + col);
+    record.player = static_cast<uint8_t>(player);
+    record.checksum = recordChecksum(record, nonce);
+
+    std::memcpy(mapped + sizeof(Header) + records * sizeof(Record), &record, sizeof(record));
+    records++;
+}
+
+bool GameJournal::grow() {
+    if (capacity >= MAX_RECORDS) {
+        return false;
+    }
+
+    int grown = std::min(capacity * 2, static_cast<int>(MAX_RECORDS));
+    qint64 size = static_cast<qint64>(sizeof(Header) + grown * sizeof(Record));
+
+    // The new records are zero, so a crash at any point leaves a journal
+    // whose valid prefix is every move recorded so far
+    file.unmap(mapped);
+    mapped = nullptr;
+    if (!file.resize(size)) {
+        std::cerr << "Cannot grow game journal: " << file.errorString().toStdString() << std::endl;
+        mapped = file.map(0, sizeof(Header) + capacity * sizeof(Record));
+        return false;
+    }
+    mapped = file.map(0, size);
+    if (!mapped) {
+        std::cerr << "Cannot map game journal: " << file.errorString().toStdString() << std::endl;
+        return false;
+    }
+
+    capacity = grown;
+    return true;
+}
+
+void GameJournal::discard() {
+    if (!file.isOpen()) {
+        return;
+    }
+
+    if (mapped) {
+        file.unmap(mapped);
+        mapped = nullptr;
+    }
+    file.close();
+    file.remove();
+    lock.reset();
+    records = 0;
+    capacity = 0;
+}
+
+void GameJournal::remove(const QString& path) {
+    QFile::remove(path);
+}
+
+QString GameJournal::lockPath(const QString& path) {
+    return path + ".lock";
+}
+
+// RECOVERY
+
+std::vector<GameJournal::RecoveredGame> GameJournal::recover() {
+    std::vector<RecoveredGame> games;
+    QString path = directory();
+    if (path.isEmpty()) {
+        return games;
+    }
+
+    QDir dir(path);
+
+    const QFileInfoList entries = dir.entryInfoList(QStringList() << "*.journal", QDir::Files, QDir::Name);
+    for (const QFileInfo& entry : entries) {
+        // A lock left by a process that has exited is stale and taken over;
+        // one held by a live instance means the game is still being played
+        // or offered there
+        std::shared_ptr<QLockFile> lock = std::make_shared<QLockFile>(lockPath(entry.filePath()));
+        lock->setStaleLockTime(0);
+        if (!lock->tryLock(0)) {
+            continue;
+        }
+
+        QFile journal(entry.filePath());
+        if (!journal.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        QByteArray bytes = journal.readAll();
+        journal.close();
+
+        Header header;
+        bool valid = bytes.size() >= static_cast<int>(sizeof(Header));
+        if (valid) {
+            std::memcpy(&header, bytes.constData(), sizeof(header));
+            valid = std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) == 0 &&
+                    header.version == JOURNAL_VERSION &&
+                    header.recordSize == sizeof(Record) &&
+                    header.checksum == headerChecksum(header);
+        }
+
+        MoveCodec::Encoder encoder;
+        if (valid) {
+            int available = static_cast<int>((bytes.size() - sizeof(Header)) / sizeof(Record));
+            for (int i = 0; i < available && i < MAX_RECORDS; i++) {
+                Record record;
+                std::memcpy(&record, bytes.constData() + sizeof(Header) + i * sizeof(Record), sizeof(record));
+
+                // The valid prefix ends at the first empty or torn record
+                if (record.sequence != i + 1 || record.checksum != recordChecksum(record, header.nonce) ||
+                    !encoder.append(static_cast<char>(record.player), record.cell / 3, record.cell % 3)) {
+                    break;
+                }
+            }
+        }
+
+        if (!valid || encoder.plyCount() == 0) {
+            remove(entry.filePath());
+            continue;
+        }
+
+        RecoveredGame game;
+        game.path = entry.filePath();
+        game.lastWritten = entry.lastModified();
+        game.gameMode = std::string(header.gameMode,
+                                    std::find(header.gameMode, header.gameMode + sizeof(header.gameMode), '\0'));
+        game.player1Id = header.player1Id;
+        game.player2Id = header.player2Id;
+        game.moveData = encoder.bytes();
+        game.plyCount = encoder.plyCount();
+        game.lock = lock;
+        games.push_back(game);
+    }
+
+    return games;
+}
+
+// CHECKSUMS
+
+uint32_t GameJournal::checksum(const void* data, size_t size, uint32_t seed) {
+    // FNV-1a; cheap and enough to catch torn or stale records
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint32_t hash = 2166136261u ^ seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t GameJournal::headerChecksum(const Header& header) {
+    Header copy = header;
+    copy.checksum = 0;
+    return checksum(&copy, sizeof(copy), 0);
+}
+
+uint32_t GameJournal::recordChecksum(const Record& record, uint32_t nonce) {
+    return checksum(&record, offsetof(Record, checksum), nonce);
+}
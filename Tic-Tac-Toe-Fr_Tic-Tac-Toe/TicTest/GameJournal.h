@@ -0,0 +1,106 @@
+#ifndef GAMEJOURNAL_H
+#define GAMEJOURNAL_H
+
+#include <QDateTime>
+#include <QFile>
+#include <QLockFile>
+#include <QString>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Crash journal for one game in progress. The file is sized up front and
+// memory mapped, so recording a move is a store of one checksummed record
+// into the mapping; the OS writes it back. A journal that is still on disk
+// at startup belongs to a game that never finished and can be recovered.
+//
+// Layout: a 64-byte header followed by 8-byte move records, room for
+// INITIAL_RECORDS at first; a longer game doubles the file and maps it again.
+// Unused records are zero; recovery reads records until one is empty or its
+// checksum fails, so a torn write only loses the move being written.
+//
+// Each journal has a lock file beside it, held by the process writing the
+// game and then by the one recovering it, so instances sharing a database
+// never take over each other's games.
+class GameJournal {
+public:
+    static const int INITIAL_RECORDS = 256;
+    static const int MAX_RECORDS = 65535; // Record sequences are 16 bits
+
+    struct RecoveredGame {
+        QString path;
+        QDateTime lastWritten;
+        std::string gameMode;
+        int player1Id;
+        int player2Id;
+        std::vector<uint8_t> moveData; // MoveCodec packed moves
+        int plyCount;
+        std::shared_ptr<QLockFile> lock; // Released once every copy is gone
+    };
+
+    GameJournal();
+    ~GameJournal();
+
+    GameJournal(const GameJournal&) = delete;
+    GameJournal& operator=(const GameJournal&) = delete;
+
+    // Creates and maps a fresh journal for one game
+    bool open(int sessionId, const std::string& gameMode, int player1Id, int player2Id);
+    bool isOpen() const { return mapped != nullptr; }
+
+    void append(char player, int row, int col);
+
+    // The game was saved or deliberately dropped; removes the file
+    void discard();
+
+    // Reads every journal left behind by an earlier run, skipping those whose
+    // lock is held by a running instance. Journals without a valid header or
+    // any moves are deleted on the way.
+    static std::vector<RecoveredGame> recover();
+    static void remove(const QString& path);
+
+    // "journal" beside the database file; empty (no journals) for memory
+    // databases
+    static QString directory();
+
+private:
+    struct Header {
+        char magic[4];
+        uint16_t version;
+        uint16_t recordSize;
+        int32_t player1Id;
+        int32_t player2Id;
+        uint32_t nonce;
+        uint32_t checksum;
+        char gameMode[40];
+    };
+
+    struct Record {
+        uint16_t sequence; // ply + 1, so 0 marks an unused record
+        uint8_t cell;
+        uint8_t player;
+        uint32_t checksum;
+    };
+
+    // Checksums cover the raw bytes, so neither struct may have padding
+    static_assert(sizeof(Header) == 64, "journal header layout");
+    static_assert(sizeof(Record) == 8, "journal record layout");
+
+    static uint32_t checksum(const void* data, size_t size, uint32_t seed);
+    static uint32_t headerChecksum(const Header& header);
+    static uint32_t recordChecksum(const Record& record, uint32_t nonce);
+
+    bool grow();
+
+    static QString lockPath(const QString& path);
+
+    QFile file;
+    std::unique_ptr<QLockFile> lock;
+    uchar* mapped;
+    uint32_t nonce;
+    int records;
+    int capacity;
+};
+
+#endif // GAMEJOURNAL_H
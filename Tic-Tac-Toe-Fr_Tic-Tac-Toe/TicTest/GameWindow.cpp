@@ -1,45 +1,112 @@
 #include "GameWindow.h"
-#include "GameHistoryManager.h"
+#include "MoveAnalysis.h"
+#include "SessionStore.h"
+#include "UserDirectory.h"
 #include "overwrite_game.h"
+#include <QCloseEvent>
 
-GameWindow::GameWindow(const QString &gameMode, QWidget *parent)
-    : QWidget(parent), currentGameMode(gameMode), aiDifficulty(1), isAIGame(false),
+GameWindow::GameWindow(QWidget *parent)
+    : QWidget(parent), currentGameMode("Classic Mode"), recorder(nullptr), aiDifficulty(1), isAIGame(false),
     currentUserId(-1), player2Id(-1), gameEnded(false)
 {
-    if (gameMode.contains("AI")) {
-        isAIGame = true;
-        if (gameMode.contains("Easy")) aiDifficulty = 1;
-        else if (gameMode.contains("Medium")) aiDifficulty = 2;
-        else if (gameMode.contains("Hard")) aiDifficulty = 3;
-    }
-
     initializeBoard(&game);
     setupUI();
+
+    // One timer per window so a pending AI reply can be cancelled on reset
+    aiMoveTimer = new QTimer(this);
+    aiMoveTimer->setSingleShot(true);
+    aiMoveTimer->setInterval(1200);
+    connect(aiMoveTimer, &QTimer::timeout, this, &GameWindow::makeAIMove);
 }
 
 GameWindow::~GameWindow()
 {
+    endRecording();
 }
 
-void GameWindow::setCurrentUser(const QString& username, int userId)
+void GameWindow::endRecording()
 {
-    currentUsername = username;
-    currentUserId = userId;
+    GameHistoryManager::getInstance()->endGame(recorder);
+    recorder = nullptr;
+}
+
+void GameWindow::configure(const QString &gameMode, const std::string& sessionToken,
+                           const QString& player2Name, int player2UserId)
+{
+    currentGameMode = gameMode;
+    isAIGame = gameMode.contains("AI");
+    aiDifficulty = 1;
+    if (gameMode.contains("Medium")) aiDifficulty = 2;
+    else if (gameMode.contains("Hard")) aiDifficulty = 3;
+
+    setWindowTitle("Tic Tac Toe - " + currentGameMode);
+    titleLabel->setText(currentGameMode);
+
+    // Hints are solved under classic rules, which Overwrite Mode breaks
+    bool classicRules = !gameMode.contains("Overwrite");
+    hintBtn->setChecked(false);
+    hintBtn->setEnabled(classicRules);
+    hintBtn->setToolTip(classicRules ? "Show how every move scores with best play"
+                                     : "Hints are not available in Overwrite Mode");
+
+    SessionStore::Session session;
+    if (SessionStore::getInstance()->lookup(sessionToken, session)) {
+        setCurrentUser(QString::fromStdString(session.username), session.userId);
+    } else {
+        setCurrentUser("Guest", -1);
+    }
+    setPlayer2(player2Name, player2UserId);
+
+    // Starts history recording for the new players and clears the board
+    resetGame();
+}
 
-    // Start recording game for history
-    if (userId != -1) {
-        GameHistoryManager* historyManager = GameHistoryManager::getInstance();
-        historyManager->startNewGame(currentGameMode.toStdString(), userId,
-                                     isAIGame ? -1 : player2Id);
+void GameWindow::resumeGame(const MoveCodec::MoveView& moves)
+{
+    int plies = 0;
+    for (const MoveCodec::Move& move : moves) {
+        game.board[move.row()][move.col()] = move.player;
+        if (recorder) {
+            recorder->recordMove(move.player, move.row(), move.col());
+        }
+        updateCell(move.row(), move.col());
+        plies++;
+    }
+
+    if (plies == 0) return;
+
+    // checkGameEnd judges the player who moved last and passes the turn on
+    game.currentPlayer = MoveCodec::playerForPly(plies - 1);
+    checkGameEnd();
+    updateHints();
+
+    if (game.gameActive && !gameEnded && isAIGame && game.currentPlayer == 'O') {
+        aiMoveTimer->start();
     }
 }
 
+void GameWindow::setCurrentUser(const QString& username, int userId)
+{
+    currentUsername = username.isEmpty() ? resolveUsername(userId) : username;
+    currentUserId = userId;
+}
+
 void GameWindow::setPlayer2(const QString& username, int userId)
 {
-    player2Username = username;
+    player2Username = username.isEmpty() ? resolveUsername(userId) : username;
     player2Id = userId;
 }
 
+QString GameWindow::resolveUsername(int userId) const
+{
+    // Served from the shared cache; GameWindow never opens the database
+    std::string username;
+    if (userId != -1 && UserDirectory::forDatabase(TicTacToeDB::location())->lookupName(userId, username)) {
+        return QString::fromStdString(username);
+    }
+    return "Guest";
+}
+
 void GameWindow::setupUI()
 {
     setWindowTitle("Tic Tac Toe - " + currentGameMode);
@@ -83,6 +150,32 @@ void GameWindow::setupUI()
         "}"
         );
 
+    hintBtn = new QPushButton("💡");
+    hintBtn->setCheckable(true);
+    hintBtn->setFixedSize(44, 32);
+    hintBtn->setStyleSheet(
+        "QPushButton {"
+        "background-color: #ffc107;"
+        "border-radius: 8px;"
+        "font-size: 16px;"
+        "border: 2px solid #e0a800;"
+        "}"
+        "QPushButton:checked {"
+        "background-color: #28a745;"
+        "border: 2px solid #1e7e34;"
+        "}"
+        "QPushButton:disabled {"
+        "background-color: #dee2e6;"
+        "border: 2px solid #ced4da;"
+        "}"
+        );
+    connect(hintBtn, &QPushButton::toggled, this, &GameWindow::updateHints);
+
+    QHBoxLayout *statusLayout = new QHBoxLayout();
+    statusLayout->setSpacing(8);
+    statusLayout->addWidget(statusLabel, 1);
+    statusLayout->addWidget(hintBtn);
+
     // Game Board Container
     QFrame *boardContainer = new QFrame();
     boardContainer->setFixedSize(350, 350);
@@ -95,46 +188,10 @@ void GameWindow::setupUI()
         "}"
         );
 
-    // Grid Widget
-    gridWidget = new QWidget(boardContainer);
-    gridWidget->setGeometry(15, 15, 320, 320);
-    gridLayout = new QGridLayout(gridWidget);
-    gridLayout->setSpacing(5);
-    gridLayout->setContentsMargins(0, 0, 0, 0);
-
-    // Create 3x3 grid
-    for (int i = 0; i < 3; i++) {
-        for (int j = 0; j < 3; j++) {
-            gridButtons[i][j] = new QPushButton();
-            gridButtons[i][j]->setFixedSize(102, 102);
-            gridButtons[i][j]->setProperty("row", i);
-            gridButtons[i][j]->setProperty("col", j);
-
-            gridButtons[i][j]->setStyleSheet(
-                "QPushButton {"
-                "background-color: #ffffff;"
-                "border: 2px solid #adb5bd;"
-                "border-radius: 10px;"
-                "font-size: 42px;"
-                "font-weight: bold;"
-                "font-family: 'Arial', sans-serif;"
-                "color: #495057;"
-                "}"
-                "QPushButton:hover {"
-                "background-color: #f1f3f4;"
-                "border-color: #007bff;"
-                "transform: scale(1.02);"
-                "}"
-                "QPushButton:pressed {"
-                "background-color: #e2e6ea;"
-                "transform: scale(0.98);"
-                "}"
-                );
-
-            connect(gridButtons[i][j], &QPushButton::clicked, this, &GameWindow::cellClicked);
-            gridLayout->addWidget(gridButtons[i][j], i, j);
-        }
-    }
+    // Board
+    boardView = new BoardView(3, boardContainer);
+    boardView->setGeometry(15, 15, 320, 320);
+    connect(boardView, &BoardView::cellClicked, this, &GameWindow::cellClicked);
 
     // Control Buttons
     QWidget *controlWidget = new QWidget();
@@ -203,7 +260,7 @@ void GameWindow::setupUI()
 
     // Add all components to main layout
     mainLayout->addWidget(titleLabel);
-    mainLayout->addWidget(statusLabel);
+    mainLayout->addLayout(statusLayout);
     mainLayout->addSpacing(8);
     mainLayout->addWidget(boardContainer, 0, Qt::AlignCenter);
     mainLayout->addSpacing(12);
@@ -218,13 +275,9 @@ void GameWindow::setupUI()
         );
 }
 
-void GameWindow::cellClicked()
+void GameWindow::cellClicked(int row, int col)
 {
-    QPushButton *button = qobject_cast<QPushButton*>(sender());
-    if (!button || !game.gameActive || gameEnded) return;
-
-    int row = button->property("row").toInt();
-    int col = button->property("col").toInt();
+    if (!game.gameActive || gameEnded) return;
 
     bool moveSuccess = false;
 
@@ -263,13 +316,13 @@ void GameWindow::cellClicked()
     if (!moveSuccess) return;
 
     // Record move for history
-    if (currentUserId != -1) {
-        GameHistoryManager* historyManager = GameHistoryManager::getInstance();
-        historyManager->recordMove(game.currentPlayer, row, col);
+    if (recorder) {
+        recorder->recordMove(game.currentPlayer, row, col);
     }
 
     updateCell(row, col);
     checkGameEnd();
+    updateHints();
 
     // Handle AI move with delay for better UX
     if (game.gameActive && !gameEnded && isAIGame && game.currentPlayer == 'O') {
@@ -287,41 +340,55 @@ void GameWindow::cellClicked()
             "}"
             );
 
-        QTimer::singleShot(1200, this, &GameWindow::makeAIMove);
+        aiMoveTimer->start();
     }
 }
 
 void GameWindow::updateCell(int row, int col)
 {
-    QString cellText = QString(game.board[row][col]);
-    gridButtons[row][col]->setText(cellText);
+    // Any move makes the heatmap stale; updateHints redraws it for the next turn
+    boardView->clearHints();
+    boardView->setCell(row, col, game.board[row][col]);
+}
 
-    if (game.board[row][col] == 'X') {
-        gridButtons[row][col]->setStyleSheet(
-            "QPushButton {"
-            "background-color: #dc3545;"
-            "border: 3px solid #c82333;"
-            "border-radius: 10px;"
-            "font-size: 42px;"
-            "font-weight: bold;"
-            "font-family: 'Arial', sans-serif;"
-            "color: white;"
-            "text-shadow: 1px 1px 2px rgba(0,0,0,0.3);"
-            "}"
-            );
-    } else if (game.board[row][col] == 'O') {
-        gridButtons[row][col]->setStyleSheet(
-            "QPushButton {"
-            "background-color: #007bff;"
-            "border: 3px solid #0056b3;"
-            "border-radius: 10px;"
-            "font-size: 42px;"
-            "font-weight: bold;"
-            "font-family: 'Arial', sans-serif;"
-            "color: white;"
-            "text-shadow: 1px 1px 2px rgba(0,0,0,0.3);"
-            "}"
-            );
+void GameWindow::updateHints()
+{
+    boardView->clearHints();
+
+    bool humanToMove = !(isAIGame && game.currentPlayer == 'O');
+    if (!hintBtn->isChecked() || currentGameMode.contains("Overwrite") || !game.gameActive || gameEnded ||
+        !humanToMove) {
+        return;
+    }
+
+    char board[PositionKey::CELLS];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            board[i * 3 + j] = game.board[i][j];
+        }
+    }
+
+    // Positions seen before in this session come straight from the table
+    std::vector<MoveAnalysis::MoveScore> scores = MoveAnalysis::scoreMoves(board, game.currentPlayer);
+    for (const MoveAnalysis::MoveScore& score : scores) {
+        QColor color;
+        QString label;
+        int rounds = (score.distance + 1) / 2;
+
+        if (score.outcome == MoveAnalysis::WIN) {
+            color = QColor("#28a745");
+            label = QString("Win in %1").arg(rounds);
+        } else if (score.outcome == MoveAnalysis::DRAW) {
+            color = QColor("#ffc107");
+            label = "Draw";
+        } else {
+            color = QColor("#dc3545");
+            label = QString("Lose in %1").arg(rounds);
+        }
+
+        // The best moves stand out, the rest are fainter
+        color.setAlpha(score.ranksWith(scores.front()) ? 150 : 70);
+        boardView->setCellHint(score.row(), score.col(), color, label);
     }
 }
 
@@ -329,8 +396,6 @@ void GameWindow::checkGameEnd()
 {
     if (gameEnded) return;
 
-    GameHistoryManager* historyManager = GameHistoryManager::getInstance();
-
     if (checkWin(&game)) {
         gameEnded = true;
         QString winner;
@@ -352,8 +417,8 @@ void GameWindow::checkGameEnd()
         }
 
         // Save game result to history
-        if (currentUserId != -1) {
-            historyManager->saveGameResult(winnerId);
+        if (recorder) {
+            recorder->saveResult(winnerId);
         }
 
         statusLabel->setText(winner);
@@ -407,15 +472,9 @@ void GameWindow::checkGameEnd()
 
         game.gameActive = false;
 
-        // Disable all buttons
-        for (int i = 0; i < 3; i++) {
-            for (int j = 0; j < 3; j++) {
-                gridButtons[i][j]->setEnabled(false);
-                QString currentStyle = gridButtons[i][j]->styleSheet();
-                gridButtons[i][j]->setStyleSheet(currentStyle +
-                                                 "QPushButton { opacity: 0.6; }");
-            }
-        }
+        // Freeze the board
+        boardView->setInteractive(false);
+        boardView->setDimmed(true);
         return;
     }
 
@@ -423,8 +482,8 @@ void GameWindow::checkGameEnd()
         gameEnded = true;
 
         // Save draw result to history
-        if (currentUserId != -1) {
-            historyManager->saveGameResult(0);
+        if (recorder) {
+            recorder->saveResult(0);
         }
 
         statusLabel->setText("🤝 It's a Draw!");
@@ -525,60 +584,48 @@ void GameWindow::makeAIMove()
         makeMove(&game, aiMove.row, aiMove.col, false);
 
         // Record AI move for history
-        if (currentUserId != -1) {
-            GameHistoryManager* historyManager = GameHistoryManager::getInstance();
-            historyManager->recordMove('O', aiMove.row, aiMove.col);
+        if (recorder) {
+            recorder->recordMove('O', aiMove.row, aiMove.col);
         }
 
         updateCell(aiMove.row, aiMove.col);
         checkGameEnd();
+        updateHints();
     }
 }
 
 void GameWindow::resetGame()
 {
-    // Clear current game and start new one for history
+    // Drop the previous game's recorder and open one for the new game
+    endRecording();
     if (currentUserId != -1) {
-        GameHistoryManager* historyManager = GameHistoryManager::getInstance();
-        historyManager->clearCurrentGame();
-        historyManager->startNewGame(currentGameMode.toStdString(), currentUserId,
-                                     isAIGame ? -1 : player2Id);
+        recorder = GameHistoryManager::getInstance()->startGame(currentGameMode.toStdString(), currentUserId,
+                                                                isAIGame ? -1 : player2Id);
     }
 
+    aiMoveTimer->stop();
     initializeBoard(&game);
     gameEnded = false;
 
-    for (int i = 0; i < 3; i++) {
-        for (int j = 0; j < 3; j++) {
-            gridButtons[i][j]->setText("");
-            gridButtons[i][j]->setEnabled(true);
-            gridButtons[i][j]->setStyleSheet(
-                "QPushButton {"
-                "background-color: #ffffff;"
-                "border: 2px solid #adb5bd;"
-                "border-radius: 10px;"
-                "font-size: 42px;"
-                "font-weight: bold;"
-                "font-family: 'Arial', sans-serif;"
-                "color: #495057;"
-                "}"
-                "QPushButton:hover {"
-                "background-color: #f1f3f4;"
-                "border-color: #007bff;"
-                "transform: scale(1.02);"
-                "}"
-                "QPushButton:pressed {"
-                "background-color: #e2e6ea;"
-                "transform: scale(0.98);"
-                "}"
-                );
-        }
-    }
+    boardView->clear();
+    boardView->setInteractive(true);
+    boardView->setDimmed(false);
 
     updateStatusLabel();
+    updateHints();
 }
 
 void GameWindow::backToMenu()
 {
     this->close();
 }
+
+void GameWindow::closeEvent(QCloseEvent *event)
+{
+    // An unfinished game is simply dropped; configure() starts the next one
+    aiMoveTimer->stop();
+    endRecording();
+
+    QWidget::closeEvent(event);
+    emit closed();
+}
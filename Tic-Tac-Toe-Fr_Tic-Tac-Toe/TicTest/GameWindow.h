@@ -10,25 +10,46 @@
 #include <QMessageBox>
 #include <QFrame>
 #include <QTimer>
+#include "BoardView.h"
 #include "classic_game.h"
 #include "ai_game.h"
+#include "GameHistoryManager.h"
 
 class GameWindow : public QWidget
 {
     Q_OBJECT
 
 public:
-    explicit GameWindow(const QString &gameMode, QWidget *parent = nullptr);
+    explicit GameWindow(QWidget *parent = nullptr);
     ~GameWindow();
 
+    // Sets mode, AI level and players, then starts a fresh game on the
+    // existing widgets. Pooled windows are reused through this alone. Player
+    // one is whoever holds the SessionStore token; an empty or expired token
+    // plays as Guest and nothing is recorded.
+    void configure(const QString &gameMode, const std::string& sessionToken,
+                   const QString& player2Name = QString(), int player2UserId = -1);
+
+    // Replays moves recovered from a crash journal onto the game started by
+    // configure(), then lets play continue from there
+    void resumeGame(const MoveCodec::MoveView& moves);
+
     // User management methods
     void setCurrentUser(const QString& username, int userId);
     void setPlayer2(const QString& username, int userId);
 
+signals:
+    // Emitted when the window is closed; it is hidden, not destroyed
+    void closed();
+
+protected:
+    void closeEvent(QCloseEvent *event) override;
+
 private slots:
-    void cellClicked();
+    void cellClicked(int row, int col);
     void resetGame();
     void backToMenu();
+    void updateHints();
 
 private:
     void setupUI();
@@ -36,22 +57,25 @@ private:
     void checkGameEnd();
     void makeAIMove();
     void updateStatusLabel();
+    void endRecording();
+    QString resolveUsername(int userId) const;
 
     QString currentGameMode;
     GameState game;
+    GameRecorder *recorder; // This window's game in the history registry
 
     // UI Components
     QVBoxLayout *mainLayout;
     QHBoxLayout *buttonLayout;
-    QGridLayout *gridLayout;
 
     QLabel *titleLabel;
     QLabel *statusLabel;
-    QWidget *gridWidget;
+    BoardView *boardView;
 
     QPushButton *resetBtn;
     QPushButton *backBtn;
-    QPushButton *gridButtons[3][3];
+    QPushButton *hintBtn; // Toggles the move heatmap
+    QTimer *aiMoveTimer;
 
     // Game variables
     int aiDifficulty;
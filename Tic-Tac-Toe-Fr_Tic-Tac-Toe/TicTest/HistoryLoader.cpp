@@ -0,0 +1,147 @@
+#include "HistoryLoader.h"
+
+HistoryLoader::HistoryLoader()
+    : database(nullptr), activeDatabase(nullptr), epoch(0), runningEpoch(0), latestGeneration(0), pendingJobs(0)
+{
+    qRegisterMetaType<TicTacToeDB::HistoryQuery>();
+    qRegisterMetaType<TicTacToeDB::HistoryPage>();
+    qRegisterMetaType<TicTacToeDB::UserStats>();
+    qRegisterMetaType<std::vector<TicTacToeDB::OpeningMove>>();
+
+    workerThread.setObjectName("HistoryLoader");
+    moveToThread(&workerThread);
+    workerThread.start();
+}
+
+HistoryLoader::~HistoryLoader()
+{
+    cancel();
+    workerThread.quit();
+    workerThread.wait();
+
+    delete database;
+}
+
+void HistoryLoader::cancel()
+{
+    epoch++;
+
+    TicTacToeDB *db = activeDatabase.load();
+    if (db) {
+        db->interrupt();
+    }
+}
+
+void HistoryLoader::run(std::function<void()> job)
+{
+    if (pendingJobs++ == 0) {
+        emit busyChanged();
+    }
+
+    int jobEpoch = epoch;
+    QMetaObject::invokeMethod(this, [this, job, jobEpoch]() {
+        runningEpoch = jobEpoch;
+        if (!stale() && openDatabase()) {
+            job();
+        }
+
+        if (--pendingJobs == 0) {
+            emit busyChanged();
+        }
+    });
+}
+
+bool HistoryLoader::openDatabase()
+{
+    if (database) {
+        return true;
+    }
+
+    // Opening (and any schema migration) happens here, never on the GUI thread
+    try {
+        database = new TicTacToeDB();
+        activeDatabase = database;
+        return true;
+    } catch (const std::exception& e) {
+        emit failed(QString("Database error: %1").arg(e.what()));
+        return false;
+    }
+}
+
+void HistoryLoader::requestPage(int generation, int pageIndex, const TicTacToeDB::HistoryQuery& query)
+{
+    run([this, generation, pageIndex, query]() {
+        if (generation < latestGeneration) {
+            return;
+        }
+
+        try {
+            TicTacToeDB::HistoryPage page = database->queryGameHistory(query);
+            if (!stale()) {
+                emit pageLoaded(generation, pageIndex, page);
+            }
+        } catch (const std::exception& e) {
+            if (!stale()) {
+                emit failed(QString("Failed to load history: %1").arg(e.what()));
+            }
+        }
+    });
+}
+
+void HistoryLoader::requestStats(int userId)
+{
+    run([this, userId]() {
+        try {
+            TicTacToeDB::UserStats stats = database->getUserStats(userId);
+            if (!stale()) {
+                emit statsLoaded(stats);
+            }
+        } catch (const std::exception& e) {
+            if (!stale()) {
+                emit failed(QString("Unable to load statistics: %1").arg(e.what()));
+            }
+        }
+    });
+}
+
+void HistoryLoader::requestDeleteAll(int userId)
+{
+    run([this, userId]() {
+        try {
+            // Chunk by chunk so saves from other windows get their turns in
+            // between. A cancelled purge stays recorded and resumes later.
+            TicTacToeDB::PurgeProgress progress = database->startPurge(userId, false);
+            while (!progress.finished && !stale()) {
+                emit purgeProgress(progress.gamesDeleted, progress.gamesTotal);
+                progress = database->purgeStep(userId);
+            }
+            if (!stale()) {
+                emit gamesDeleted(true);
+            }
+            // Opponents' ratings catch up batch by batch; left unfinished,
+            // the backfill thread completes the rebuild on the next start
+            while (!stale() && database->resumeRatingRebuild()) {
+            }
+        } catch (const std::exception& e) {
+            if (!stale()) {
+                emit failed(QString("Database error: %1").arg(e.what()));
+            }
+        }
+    });
+}
+
+void HistoryLoader::requestOpenings(int requestId, const std::string& board, const std::string& gameMode)
+{
+    run([this, requestId, board, gameMode]() {
+        try {
+            std::vector<TicTacToeDB::OpeningMove> moves = database->queryOpenings(board.c_str(), gameMode);
+            if (!stale()) {
+                emit openingsLoaded(requestId, moves);
+            }
+        } catch (const std::exception& e) {
+            if (!stale()) {
+                emit failed(QString("Unable to load opening statistics: %1").arg(e.what()));
+            }
+        }
+    });
+}
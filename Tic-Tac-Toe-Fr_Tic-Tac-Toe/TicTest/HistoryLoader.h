@@ -0,0 +1,69 @@
+#ifndef HISTORYLOADER_H
+#define HISTORYLOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+#include "TicTacToeDB.h"
+
+Q_DECLARE_METATYPE(TicTacToeDB::HistoryQuery)
+Q_DECLARE_METATYPE(TicTacToeDB::HistoryPage)
+Q_DECLARE_METATYPE(TicTacToeDB::UserStats)
+Q_DECLARE_METATYPE(std::vector<TicTacToeDB::OpeningMove>)
+
+// Runs HistoryWindow's database work on a dedicated thread with its own
+// sqlite connection. The request* methods are called from the GUI thread and
+// queue one job each; results come back through queued signals.
+class HistoryLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    HistoryLoader();
+    ~HistoryLoader();
+
+    void requestPage(int generation, int pageIndex, const TicTacToeDB::HistoryQuery& query);
+    void requestStats(int userId);
+    void requestDeleteAll(int userId);
+    // board is CELLS chars as in ReplayTimeline::boardAt
+    void requestOpenings(int requestId, const std::string& board, const std::string& gameMode);
+
+    // Pages from older generations are skipped instead of queried
+    void supersede(int generation) { latestGeneration = generation; }
+
+    // Abort the running query and drop everything still queued. Requests
+    // made afterwards run normally, so a pooled window can reuse the loader.
+    void cancel();
+
+    bool isBusy() const { return pendingJobs > 0; }
+
+signals:
+    void busyChanged();
+    void pageLoaded(int generation, int pageIndex, const TicTacToeDB::HistoryPage& page);
+    void statsLoaded(const TicTacToeDB::UserStats& stats);
+    void purgeProgress(int gamesDeleted, int gamesTotal);
+    void gamesDeleted(bool success);
+    void openingsLoaded(int requestId, const std::vector<TicTacToeDB::OpeningMove>& moves);
+    void failed(const QString& message);
+
+private:
+    void run(std::function<void()> job);
+    bool openDatabase();
+
+    // True once the job being run was queued before the latest cancel()
+    bool stale() const { return runningEpoch != epoch; }
+
+    QThread workerThread;
+    TicTacToeDB *database; // Created and used on workerThread only
+    std::atomic<TicTacToeDB*> activeDatabase;
+    std::atomic<int> epoch;
+    int runningEpoch; // Epoch of the job on workerThread
+    std::atomic<int> latestGeneration;
+    std::atomic<int> pendingJobs;
+};
+
+#endif // HISTORYLOADER_H
@@ -0,0 +1,159 @@
+#include "MaintenanceScheduler.h"
+#include "Diagnostics.h"
+#include "TicTacToeDB.h"
+#include "WriteQueue.h"
+#include <algorithm>
+#include <iostream>
+
+MaintenanceScheduler::~MaintenanceScheduler() {
+    stop();
+}
+
+void MaintenanceScheduler::start() {
+    if (worker.joinable()) {
+        return;
+    }
+    stopping = false;
+    worker = std::thread(&MaintenanceScheduler::run, this);
+}
+
+void MaintenanceScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+MaintenanceScheduler::Report MaintenanceScheduler::runPass(TicTacToeDB& database, std::chrono::milliseconds budget,
+                                                           bool optimize, const std::function<bool()>& shouldYield) {
+    Report report;
+    Clock::time_point start = Clock::now();
+    auto mustStop = [&]() { return Clock::now() - start >= budget || shouldYield(); };
+    auto finish = [&](bool finished) {
+        report.finished = finished;
+        report.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        return report;
+    };
+
+    const char* schemas[] = {"main", "archive"};
+
+    // Free pages first; with WAL the checkpoint below is what shrinks the file
+    for (const char* schema : schemas) {
+        if (!database.incrementalVacuumEnabled(schema)) {
+            if (database.fileSize(schema) > CONVERT_LIMIT) {
+                report.conversionNeeded = true;
+                continue;
+            }
+            if (mustStop()) {
+                return finish(false);
+            }
+            // Pointer map pages can make the converted file slightly larger
+            report.bytesFreed += std::max(database.vacuum(schema), 0LL);
+            report.filesConverted++;
+            continue;
+        }
+        int pageSize = database.pageSize(schema);
+        while (database.freePages(schema) > 0) {
+            if (mustStop()) {
+                return finish(false);
+            }
+            int freed = database.incrementalVacuum(schema, VACUUM_STEP_PAGES);
+            if (freed <= 0) {
+                break;
+            }
+            report.pagesFreed += freed;
+            report.bytesFreed += static_cast<long long>(freed) * pageSize;
+        }
+    }
+
+    if (optimize) {
+        if (mustStop()) {
+            return finish(false);
+        }
+        database.optimize();
+        report.optimized = true;
+    }
+
+    for (const char* schema : schemas) {
+        if (mustStop()) {
+            return finish(false);
+        }
+        report.framesCheckpointed += database.checkpoint(schema);
+    }
+
+    return finish(true);
+}
+
+void MaintenanceScheduler::Report::print(std::ostream& out) const {
+    out << "Maintenance: reclaimed " << bytesFreed / 1024 << " KB (" << pagesFreed << " pages), checkpointed "
+        << framesCheckpointed << " frames" << (optimized ? ", optimized" : "");
+    if (filesConverted > 0) {
+        out << ", converted " << filesConverted << " file(s) to incremental vacuum";
+    }
+    out << "; " << static_cast<int>(elapsedMs) << " ms" << (finished ? "" : ", more to do") << std::endl;
+}
+
+void MaintenanceScheduler::run() {
+    try {
+        TicTacToeDB database;
+        WriteQueue* queue = WriteQueue::getInstance();
+
+        // Idle means the write count stayed put; the first idle period
+        // after startup always gets a pass
+        uint64_t seenWrites = queue->metrics().writes;
+        Clock::time_point quietSince = Clock::now();
+        Clock::time_point lastOptimized = Clock::now() - OPTIMIZE_INTERVAL;
+        bool pending = true;
+        bool conversionReported = false;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!wake.wait_for(lock, CHECK_INTERVAL, [this]() { return stopping.load(); })) {
+            uint64_t writes = queue->metrics().writes;
+            Clock::time_point now = Clock::now();
+            if (writes != seenWrites) {
+                seenWrites = writes;
+                quietSince = now;
+                pending = true;
+                continue;
+            }
+            if (!pending || now - quietSince < IDLE_AFTER) {
+                continue;
+            }
+
+            lock.unlock();
+            bool interrupted = false;
+            Report report = runPass(database, RUN_BUDGET, now - lastOptimized >= OPTIMIZE_INTERVAL,
+                                    [this, queue, &interrupted]() {
+                                        interrupted = queue->pending() > 0 || stopping;
+                                        return interrupted;
+                                    });
+            lock.lock();
+
+            if (report.optimized) {
+                lastOptimized = now;
+            }
+            if (report.didWork() && Diagnostics::enabled()) {
+                report.print(std::cerr);
+            }
+            if (report.conversionNeeded && !conversionReported) {
+                std::cerr << "Database files created before incremental vacuum only shrink after running "
+                             "the game once with --vacuum" << std::endl;
+                conversionReported = true;
+            }
+
+            // Our own turns are not activity; someone else's write is, and
+            // restarts the wait for an idle period
+            pending = !report.finished;
+            seenWrites = queue->metrics().writes;
+            if (interrupted) {
+                quietSince = Clock::now();
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Maintenance stopped: " << e.what() << std::endl;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef MAINTENANCESCHEDULER_H
+#define MAINTENANCESCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+class TicTacToeDB;
+
+// Keeps the database files compact and the planner statistics fresh
+// without getting in the way of play. A background thread with its own
+// connection waits until nothing has been written for IDLE_AFTER, then
+// works through incremental vacuum of both files, PRAGMA optimize (at most
+// once per OPTIMIZE_INTERVAL) and a passive WAL checkpoint.
+//
+// auto_vacuum only takes effect on a new file, so a file created before it
+// is converted with a full VACUUM in its first idle pass when it holds no
+// more than CONVERT_LIMIT bytes. A bigger file would hold writers off for
+// too long; the scheduler says once per run that --vacuum is needed.
+//
+// Every other step is one short write turn at most. A pass stops as soon as
+// another writer queues or RUN_BUDGET is spent, and picks up again at the
+// next idle check; nothing runs again until new writes come in.
+class MaintenanceScheduler {
+public:
+    static constexpr std::chrono::seconds IDLE_AFTER{10};
+    static constexpr std::chrono::seconds CHECK_INTERVAL{2};
+    static constexpr std::chrono::milliseconds RUN_BUDGET{100};
+    static constexpr std::chrono::hours OPTIMIZE_INTERVAL{1};
+    static const int VACUUM_STEP_PAGES = 128;
+    static const long long CONVERT_LIMIT = 8 * 1024 * 1024;
+
+    struct Report {
+        int pagesFreed = 0;
+        long long bytesFreed = 0;
+        int framesCheckpointed = 0;
+        bool optimized = false;
+        int filesConverted = 0;
+        bool conversionNeeded = false; // A file too big to convert while idle
+        double elapsedMs = 0;
+        bool finished = false; // False if the pass yielded with work left
+
+        bool didWork() const { return pagesFreed > 0 || framesCheckpointed > 0 || optimized || filesConverted > 0; }
+        void print(std::ostream& out) const;
+    };
+
+    MaintenanceScheduler() = default;
+    ~MaintenanceScheduler();
+
+    MaintenanceScheduler(const MaintenanceScheduler&) = delete;
+    MaintenanceScheduler& operator=(const MaintenanceScheduler&) = delete;
+
+    void start();
+    void stop(); // Waits for a running step to finish
+
+    // One pass over the tasks on the given connection; checks shouldYield()
+    // and the budget before every step
+    static Report runPass(TicTacToeDB& database, std::chrono::milliseconds budget, bool optimize,
+                          const std::function<bool()>& shouldYield);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void run();
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping{false};
+};
+
+#endif // MAINTENANCESCHEDULER_H
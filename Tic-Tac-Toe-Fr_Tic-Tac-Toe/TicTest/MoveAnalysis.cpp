@@ -0,0 +1,154 @@
+#include "MoveAnalysis.h"
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+
+namespace MoveAnalysis {
+
+namespace {
+
+using PositionKey::CELLS;
+
+const int LINES[8][3] = {
+    {0, 1, 2}, {3, 4, 5}, {6, 7, 8}, // rows
+    {0, 3, 6}, {1, 4, 7}, {2, 5, 8}, // columns
+    {0, 4, 8}, {2, 4, 6}             // diagonals
+};
+
+// Solved value of a position for the side to move, packed into a byte:
+// 0 = not solved yet, otherwise (outcome + 1) * 16 + distance + 1
+uint8_t solved[PositionKey::KEY_COUNT * 2];
+int solvedCount = 0;
+std::mutex solvedMutex;
+
+struct Value {
+    Outcome outcome;
+    int distance;
+};
+
+uint8_t pack(const Value& value) {
+    return static_cast<uint8_t>((value.outcome + 1) * 16 + value.distance + 1);
+}
+
+Value unpack(uint8_t packed) {
+    return Value{static_cast<Outcome>(packed / 16 - 1), packed % 16 - 1};
+}
+
+bool hasLine(const char* board, char player) {
+    for (const auto& line : LINES) {
+        if (board[line[0]] == player && board[line[1]] == player && board[line[2]] == player) {
+            return true;
+        }
+    }
+    return false;
+}
+
+char opponent(char player) {
+    return player == 'X' ? 'O' : 'X';
+}
+
+// Decided positions, or false if play goes on
+bool terminalValue(const char* board, char toMove, Value& value) {
+    if (hasLine(board, opponent(toMove))) {
+        value = Value{LOSS, 0};
+        return true;
+    }
+    if (hasLine(board, toMove)) {
+        value = Value{WIN, 0};
+        return true;
+    }
+    if (std::find(board, board + CELLS, ' ') == board + CELLS) {
+        value = Value{DRAW, 0};
+        return true;
+    }
+    return false;
+}
+
+MoveScore scoreFor(int cell, const Value& reply) {
+    // The opponent's result one ply later, seen from this side
+    return MoveScore{cell, static_cast<Outcome>(-reply.outcome), reply.distance + 1};
+}
+
+// Negamax over canonical positions; caller holds solvedMutex
+Value solve(char* board, char toMove) {
+    int slot = PositionKey::canonical(board) * 2 + (toMove == 'O');
+    if (solved[slot] != 0) {
+        return unpack(solved[slot]);
+    }
+
+    Value value;
+    if (!terminalValue(board, toMove, value)) {
+        MoveScore best{-1, LOSS, 0};
+        for (int cell = 0; cell < CELLS; cell++) {
+            if (board[cell] != ' ') continue;
+
+            board[cell] = toMove;
+            MoveScore score = scoreFor(cell, solve(board, opponent(toMove)));
+            board[cell] = ' ';
+
+            if (best.cell == -1 || score.betterThan(best)) {
+                best = score;
+            }
+        }
+        value = Value{best.outcome, best.distance};
+    }
+
+    solved[slot] = pack(value);
+    solvedCount++;
+    return value;
+}
+
+}
+
+// RANKING
+
+bool MoveScore::betterThan(const MoveScore& other) const {
+    if (outcome != other.outcome) {
+        return outcome > other.outcome;
+    }
+    if (outcome == WIN) {
+        return distance < other.distance;
+    }
+    if (outcome == LOSS) {
+        return distance > other.distance;
+    }
+    return false;
+}
+
+bool MoveScore::ranksWith(const MoveScore& other) const {
+    return !betterThan(other) && !other.betterThan(*this);
+}
+
+// ANALYSIS
+
+std::vector<MoveScore> scoreMoves(const char* board, char toMove) {
+    std::vector<MoveScore> scores;
+
+    char work[CELLS];
+    std::copy(board, board + CELLS, work);
+
+    Value value;
+    if (terminalValue(work, toMove, value)) {
+        return scores;
+    }
+
+    std::lock_guard<std::mutex> lock(solvedMutex);
+    for (int cell = 0; cell < CELLS; cell++) {
+        if (work[cell] != ' ') continue;
+
+        work[cell] = toMove;
+        scores.push_back(scoreFor(cell, solve(work, opponent(toMove))));
+        work[cell] = ' ';
+    }
+
+    std::stable_sort(scores.begin(), scores.end(),
+                     [](const MoveScore& a, const MoveScore& b) { return a.betterThan(b); });
+    return scores;
+}
+
+int cachedPositions() {
+    std::lock_guard<std::mutex> lock(solvedMutex);
+    return solvedCount;
+}
+
+}
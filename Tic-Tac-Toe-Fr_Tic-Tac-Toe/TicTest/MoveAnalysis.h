@@ -0,0 +1,43 @@
+#ifndef MOVEANALYSIS_H
+#define MOVEANALYSIS_H
+
+#include "PositionKey.h"
+#include <vector>
+
+// Perfect-play scores for every legal move of a classic 3x3 position. Each
+// position is solved once and kept in a table indexed by its canonical
+// PositionKey and the side to move, so the first call fills in everything
+// reachable from it and later calls for the rest of the session are table
+// lookups. Overwrite mode has different rules and is not covered.
+namespace MoveAnalysis {
+
+enum Outcome {
+    LOSS = -1,
+    DRAW = 0,
+    WIN = 1
+};
+
+struct MoveScore {
+    int cell;        // Row-major, 0-8
+    Outcome outcome; // For the side that plays the move
+    int distance;    // Plies until the game ends with best play, this move included
+
+    int row() const { return cell / 3; }
+    int col() const { return cell % 3; }
+
+    // Faster wins and slower losses rank higher; draws rank alike
+    bool betterThan(const MoveScore& other) const;
+    bool ranksWith(const MoveScore& other) const;
+};
+
+// Every empty cell of `board` (PositionKey::CELLS chars of ' ', 'X', 'O')
+// scored for `toMove`, best first and row-major among equals. Empty once the
+// game is over. Thread safe.
+std::vector<MoveScore> scoreMoves(const char* board, char toMove);
+
+// Positions solved so far this session
+int cachedPositions();
+
+}
+
+#endif // MOVEANALYSIS_H
@@ -0,0 +1,104 @@
+#include "MoveCodec.h"
+
+namespace MoveCodec {
+
+// DECODER
+
+MoveView::const_iterator::const_iterator(const uint8_t* data, size_t nibbleCount, size_t nibblePos)
+    : data(data), nibbleCount(nibbleCount), pos(nibblePos), next(nibblePos), ply(0),
+    current{-1, 'X', false} {
+    decode();
+}
+
+MoveView::const_iterator& MoveView::const_iterator::operator++() {
+    pos = next;
+    ply++;
+    decode();
+    return *this;
+}
+
+uint8_t MoveView::const_iterator::nibbleAt(size_t index) const {
+    uint8_t byte = data[index / 2];
+    return (index % 2 == 0) ? static_cast<uint8_t>(byte >> 4) : static_cast<uint8_t>(byte & 0x0F);
+}
+
+void MoveView::const_iterator::decode() {
+    if (pos >= nibbleCount) {
+        pos = nibbleCount;
+        return;
+    }
+
+    size_t index = pos;
+    uint8_t nibble = nibbleAt(index++);
+    bool overwrite = false;
+
+    if (nibble == OVERWRITE_ESCAPE && index < nibbleCount) {
+        overwrite = true;
+        nibble = nibbleAt(index++);
+    }
+
+    // Padding or a corrupt nibble ends the sequence
+    if (nibble >= BOARD_CELLS) {
+        pos = nibbleCount;
+        return;
+    }
+
+    current.cell = nibble;
+    current.player = playerForPly(ply);
+    current.overwrite = overwrite;
+    next = index;
+}
+
+int MoveView::plyCount() const {
+    int count = 0;
+    for (const_iterator it = begin(); it != end(); ++it) {
+        count++;
+    }
+    return count;
+}
+
+// LEGACY TEXT FORMAT
+
+bool encodeLegacy(const std::string& text, std::vector<uint8_t>& out) {
+    Encoder encoder;
+    size_t start = 0;
+
+    while (start < text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+
+        if (end - start < 3) {
+            return false;
+        }
+
+        char player = text[start];
+        int row = text[start + 1] - '0';
+        int col = text[start + 2] - '0';
+
+        if (!encoder.append(player, row, col)) {
+            return false;
+        }
+
+        start = end + 1;
+    }
+
+    out = encoder.bytes();
+    return true;
+}
+
+bool encodeLegacy(const std::vector<std::string>& moves, std::vector<uint8_t>& out) {
+    Encoder encoder;
+
+    for (const auto& move : moves) {
+        if (move.length() < 3 || !encoder.append(move[0], move[1] - '0', move[2] - '0')) {
+            return false;
+        }
+    }
+
+    out = encoder.bytes();
+    return true;
+}
+
+}
@@ -0,0 +1,184 @@
+#ifndef MOVECODEC_H
+#define MOVECODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Packed binary move format stored in games.move_data.
+//
+// Every ply is one nibble holding the cell index (row * 3 + col), high nibble
+// first. The mover is implied by ply parity: X plays even plies, O odd ones.
+// A move onto an occupied cell (Overwrite mode) is prefixed with an
+// OVERWRITE_ESCAPE nibble, and an odd trailing nibble is filled with PADDING.
+namespace MoveCodec {
+
+const uint8_t OVERWRITE_ESCAPE = 0xE;
+const uint8_t PADDING = 0xF;
+const int BOARD_CELLS = 9;
+
+inline char playerForPly(int ply) {
+    return (ply % 2 == 0) ? 'X' : 'O';
+}
+
+struct Move {
+    int cell;
+    char player;
+    bool overwrite;
+
+    int row() const { return cell / 3; }
+    int col() const { return cell % 3; }
+};
+
+// Non-owning view over an encoded buffer. Iterating decodes in place, so
+// walking a replay never allocates.
+class MoveView {
+public:
+    class const_iterator {
+    public:
+        const_iterator(const uint8_t* data, size_t nibbleCount, size_t nibblePos);
+
+        const Move& operator*() const { return current; }
+        const Move* operator->() const { return &current; }
+        const_iterator& operator++();
+        bool operator==(const const_iterator& other) const { return pos == other.pos; }
+        bool operator!=(const const_iterator& other) const { return pos != other.pos; }
+
+    private:
+        void decode();
+        uint8_t nibbleAt(size_t index) const;
+
+        const uint8_t* data;
+        size_t nibbleCount;
+        size_t pos;
+        size_t next;
+        int ply;
+        Move current;
+    };
+
+    MoveView() : data(nullptr), size(0) {}
+    MoveView(const uint8_t* data, size_t size) : data(data), size(size) {}
+    explicit MoveView(const std::vector<uint8_t>& bytes)
+        : data(bytes.data()), size(bytes.size()) {}
+
+    const_iterator begin() const { return const_iterator(data, size * 2, 0); }
+    const_iterator end() const { return const_iterator(data, size * 2, size * 2); }
+
+    bool empty() const { return begin() == end(); }
+    int plyCount() const;
+
+private:
+    const uint8_t* data;
+    size_t size;
+};
+
+// Byte storage for BasicEncoder that holds the first Capacity bytes inline
+// and moves to the heap once, if the game outgrows them.
+template <size_t Capacity>
+class SmallBuffer {
+public:
+    SmallBuffer() : length(0) {}
+
+    void clear() {
+        length = 0;
+        heap.clear();
+    }
+
+    void push_back(uint8_t byte) {
+        if (length < Capacity) {
+            inlineBytes[length] = byte;
+        } else {
+            if (length == Capacity) {
+                heap.reserve(Capacity * 2);
+                heap.assign(inlineBytes, inlineBytes + Capacity);
+            }
+            heap.push_back(byte);
+        }
+        length++;
+    }
+
+    uint8_t& back() { return onHeap() ? heap.back() : inlineBytes[length - 1]; }
+    const uint8_t* data() const { return onHeap() ? heap.data() : inlineBytes; }
+    size_t size() const { return length; }
+
+private:
+    bool onHeap() const { return length > Capacity; }
+
+    uint8_t inlineBytes[Capacity];
+    std::vector<uint8_t> heap;
+    size_t length;
+};
+
+// Appends moves one at a time, tracking occupied cells so overwrites are
+// flagged without the caller having to know the board. Buffer is any byte
+// container with push_back, back, clear, data and size.
+template <class Buffer>
+class BasicEncoder {
+public:
+    BasicEncoder() : occupied(0), plies(0), halfByte(false) {}
+
+    void clear() {
+        data.clear();
+        occupied = 0;
+        plies = 0;
+        halfByte = false;
+    }
+
+    bool append(char player, int row, int col) {
+        if (row < 0 || row > 2 || col < 0 || col > 2) {
+            return false;
+        }
+
+        if (player != playerForPly(plies)) {
+            return false;
+        }
+
+        int cell = row * 3 + col;
+        uint16_t bit = static_cast<uint16_t>(1u << cell);
+
+        if (occupied & bit) {
+            pushNibble(OVERWRITE_ESCAPE);
+        }
+        pushNibble(static_cast<uint8_t>(cell));
+
+        occupied |= bit;
+        plies++;
+        return true;
+    }
+
+    const Buffer& bytes() const { return data; }
+    int plyCount() const { return plies; }
+    MoveView view() const { return MoveView(data.data(), data.size()); }
+
+private:
+    void pushNibble(uint8_t nibble) {
+        if (halfByte) {
+            data.back() = static_cast<uint8_t>((data.back() & 0xF0) | nibble);
+        } else {
+            data.push_back(static_cast<uint8_t>((nibble << 4) | PADDING));
+        }
+        halfByte = !halfByte;
+    }
+
+    Buffer data;
+    uint16_t occupied;
+    int plies;
+    bool halfByte;
+};
+
+using Encoder = BasicEncoder<std::vector<uint8_t>>;
+
+// For recorders that must not allocate on the move path: the first Capacity
+// bytes of a game are stored inline
+template <size_t Capacity>
+using InlineEncoder = BasicEncoder<SmallBuffer<Capacity>>;
+
+// Converts the legacy comma separated text format ("X00,O11,...") in a single
+// pass. Returns false if the text is malformed or breaks ply parity.
+bool encodeLegacy(const std::string& text, std::vector<uint8_t>& out);
+bool encodeLegacy(const std::vector<std::string>& moves, std::vector<uint8_t>& out);
+
+}
+
+#endif // MOVECODEC_H
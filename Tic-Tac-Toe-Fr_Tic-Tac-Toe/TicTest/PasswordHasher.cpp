@@ -0,0 +1,258 @@
+#include "PasswordHasher.h"
+#include "Sha256.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+
+namespace PasswordHasher {
+
+namespace {
+
+const char* const PREFIX = "pbkdf2-sha256$";
+const int LEGACY_HEX_LENGTH = 64;
+const int CALIBRATION_ITERATIONS = 20000;
+const int COST_STEP = 10000;
+
+std::atomic<int> currentIterations(MIN_ITERATIONS);
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+std::string toHex(const uint8_t* bytes, size_t size) {
+    std::string hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; i++) {
+        hex += HEX_DIGITS[bytes[i] >> 4];
+        hex += HEX_DIGITS[bytes[i] & 0xF];
+    }
+    return hex;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool fromHex(const std::string& hex, std::vector<uint8_t>& bytes) {
+    if (hex.empty() || hex.size() % 2 != 0) {
+        return false;
+    }
+
+    bytes.clear();
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        int high = hexValue(hex[i]);
+        int low = hexValue(hex[i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        bytes.push_back(static_cast<uint8_t>(high << 4 | low));
+    }
+    return true;
+}
+
+// Runs over the whole length whatever the contents, so the time taken
+// doesn't tell how many leading bytes matched
+bool constantTimeEquals(const uint8_t* a, const uint8_t* b, size_t size) {
+    uint8_t difference = 0;
+    for (size_t i = 0; i < size; i++) {
+        difference |= a[i] ^ b[i];
+    }
+    return difference == 0;
+}
+
+// HMAC-SHA256 with the key's inner and outer pad blocks hashed once up
+// front. Each PBKDF2 round then costs two compressions instead of four.
+class Hmac {
+public:
+    explicit Hmac(const std::string& key) {
+        uint8_t block[Sha256::BLOCK_SIZE] = {};
+        if (key.size() > sizeof(block)) {
+            Sha256::Digest digest = Sha256::hash(key.data(), key.size());
+            std::copy(digest.begin(), digest.end(), block);
+        } else {
+            std::copy(key.begin(), key.end(), block);
+        }
+
+        uint8_t pad[Sha256::BLOCK_SIZE];
+        for (size_t i = 0; i < sizeof(block); i++) {
+            pad[i] = block[i] ^ 0x36;
+        }
+        inner.update(pad, sizeof(pad));
+        for (size_t i = 0; i < sizeof(block); i++) {
+            pad[i] = block[i] ^ 0x5c;
+        }
+        outer.update(pad, sizeof(pad));
+    }
+
+    void sign(const uint8_t* message, size_t size, uint8_t* out) const {
+        Sha256::Context hasher = inner;
+        hasher.update(message, size);
+        Sha256::Digest digest = hasher.finish();
+
+        hasher = outer;
+        hasher.update(digest.data(), digest.size());
+        digest = hasher.finish();
+        std::copy(digest.begin(), digest.end(), out);
+    }
+
+private:
+    Sha256::Context inner;
+    Sha256::Context outer;
+};
+
+struct StoredHash {
+    int iterations = 0;
+    std::vector<uint8_t> salt;
+    std::vector<uint8_t> hash;
+};
+
+bool parse(const std::string& stored, StoredHash& out) {
+    size_t prefixLength = std::char_traits<char>::length(PREFIX);
+    if (stored.compare(0, prefixLength, PREFIX) != 0) {
+        return false;
+    }
+
+    size_t saltStart = stored.find('$', prefixLength);
+    size_t hashStart = saltStart == std::string::npos ? saltStart : stored.find('$', saltStart + 1);
+    if (hashStart == std::string::npos) {
+        return false;
+    }
+
+    std::string cost = stored.substr(prefixLength, saltStart - prefixLength);
+    char* end = nullptr;
+    long iterations = std::strtol(cost.c_str(), &end, 10);
+    if (cost.empty() || *end != '\0' || iterations < 1 || iterations > MAX_ITERATIONS) {
+        return false;
+    }
+    out.iterations = static_cast<int>(iterations);
+
+    return fromHex(stored.substr(saltStart + 1, hashStart - saltStart - 1), out.salt) &&
+           fromHex(stored.substr(hashStart + 1), out.hash);
+}
+
+bool isLegacy(const std::string& stored) {
+    if (stored.size() != LEGACY_HEX_LENGTH) {
+        return false;
+    }
+    return std::all_of(stored.begin(), stored.end(), [](char c) { return hexValue(c) >= 0; });
+}
+
+}
+
+// COST
+
+int iterations() {
+    return currentIterations;
+}
+
+void setIterations(int count) {
+    currentIterations = std::max(MIN_ITERATIONS, std::min(count, MAX_ITERATIONS));
+}
+
+int calibrate(int targetMs) {
+    std::vector<uint8_t> salt(SALT_BYTES, 0);
+
+    auto start = std::chrono::steady_clock::now();
+    pbkdf2("calibration", salt, CALIBRATION_ITERATIONS, HASH_BYTES);
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    double perIteration = std::max(elapsed, 1.0) / CALIBRATION_ITERATIONS;
+    double count = targetMs / perIteration;
+
+    // Rounded down to a step so that small timing noise between runs doesn't
+    // change the cost and trigger rehashes
+    int rounded = static_cast<int>(std::min(count, static_cast<double>(MAX_ITERATIONS))) / COST_STEP * COST_STEP;
+    return std::max(MIN_ITERATIONS, rounded);
+}
+
+// HASHING
+
+std::vector<uint8_t> pbkdf2(const std::string& password, const std::vector<uint8_t>& salt, int iterations,
+                            size_t length) {
+    Hmac hmac(password);
+    std::vector<uint8_t> derived;
+    derived.reserve(length);
+
+    std::vector<uint8_t> message(salt);
+    message.resize(salt.size() + 4);
+
+    for (uint32_t block = 1; derived.size() < length; block++) {
+        // U1 = HMAC(password, salt || INT_32_BE(block))
+        message[salt.size()] = static_cast<uint8_t>(block >> 24);
+        message[salt.size() + 1] = static_cast<uint8_t>(block >> 16);
+        message[salt.size() + 2] = static_cast<uint8_t>(block >> 8);
+        message[salt.size() + 3] = static_cast<uint8_t>(block);
+
+        uint8_t u[Sha256::DIGEST_SIZE];
+        uint8_t t[Sha256::DIGEST_SIZE];
+        hmac.sign(message.data(), message.size(), u);
+        std::copy(u, u + sizeof(u), t);
+
+        for (int i = 1; i < iterations; i++) {
+            hmac.sign(u, sizeof(u), u);
+            for (size_t j = 0; j < sizeof(t); j++) {
+                t[j] ^= u[j];
+            }
+        }
+
+        size_t take = std::min(sizeof(t), length - derived.size());
+        derived.insert(derived.end(), t, t + take);
+    }
+
+    return derived;
+}
+
+std::string hash(const std::string& password, int cost) {
+    if (cost <= 0) {
+        cost = iterations();
+    }
+
+    std::random_device random;
+    std::vector<uint8_t> salt(SALT_BYTES);
+    for (uint8_t& byte : salt) {
+        byte = static_cast<uint8_t>(random());
+    }
+
+    std::vector<uint8_t> derived = pbkdf2(password, salt, cost, HASH_BYTES);
+    return PREFIX + std::to_string(cost) + "$" + toHex(salt.data(), salt.size()) + "$" +
+           toHex(derived.data(), derived.size());
+}
+
+bool verify(const std::string& password, const std::string& stored) {
+    StoredHash parsed;
+    if (parse(stored, parsed)) {
+        std::vector<uint8_t> derived = pbkdf2(password, parsed.salt, parsed.iterations, parsed.hash.size());
+        return constantTimeEquals(derived.data(), parsed.hash.data(), derived.size());
+    }
+
+    if (isLegacy(stored)) {
+        std::vector<uint8_t> expected;
+        fromHex(stored, expected);
+        Sha256::Digest digest = Sha256::hash(password.data(), password.size());
+        return constantTimeEquals(digest.data(), expected.data(), digest.size());
+    }
+
+    return false;
+}
+
+int costOf(const std::string& stored) {
+    StoredHash parsed;
+    if (parse(stored, parsed)) {
+        return parsed.iterations;
+    }
+    return isLegacy(stored) ? 0 : -1;
+}
+
+bool needsRehash(const std::string& stored) {
+    return costOf(stored) < iterations();
+}
+
+std::string placeholderHash() {
+    return PREFIX + std::to_string(iterations()) + "$" + std::string(SALT_BYTES * 2, '0') + "$" +
+           std::string(HASH_BYTES * 2, '0');
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef PASSWORDHASHER_H
+#define PASSWORDHASHER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Salted, iteration-tunable password hashes (PBKDF2-HMAC-SHA256 on top of
+// Sha256). A stored hash carries its own cost and salt:
+//
+//   pbkdf2-sha256$<iterations>$<salt hex>$<hash hex>
+//
+// so the cost can be raised at any time; older hashes keep verifying and are
+// replaced on the next successful login (see needsRehash). Plain 64-digit
+// hex is the unsalted SHA-256 written by earlier versions and is still
+// accepted.
+//
+// Hashing is deliberately slow. Callers on the GUI thread should run hash()
+// and verify() on a worker thread.
+namespace PasswordHasher {
+
+const int MIN_ITERATIONS = 100000;
+const int MAX_ITERATIONS = 5000000;
+const int SALT_BYTES = 16;
+const int HASH_BYTES = 32;
+
+// Cost used for new hashes; starts at MIN_ITERATIONS. Thread safe.
+int iterations();
+void setIterations(int count);
+
+// Times a short run and returns the iteration count that takes about
+// targetMs on this machine, rounded and clamped to the limits above
+int calibrate(int targetMs);
+
+// New hash with a fresh random salt at the given cost (0 = iterations())
+std::string hash(const std::string& password, int cost = 0);
+
+// Constant-time check against a stored hash of either format
+bool verify(const std::string& password, const std::string& stored);
+
+// Cost of a stored hash; 0 for legacy hashes, -1 if unrecognised
+int costOf(const std::string& stored);
+
+// True for legacy hashes and hashes cheaper than iterations()
+bool needsRehash(const std::string& stored);
+
+// Well-formed hash at the current cost that no password matches. Verifying
+// against it for unknown usernames takes as long as for real accounts.
+std::string placeholderHash();
+
+std::vector<uint8_t> pbkdf2(const std::string& password, const std::vector<uint8_t>& salt, int iterations,
+                            size_t length);
+
+}
+
+#endif // PASSWORDHASHER_H
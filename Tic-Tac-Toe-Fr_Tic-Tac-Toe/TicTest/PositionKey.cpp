@@ -0,0 +1,73 @@
+#include "PositionKey.h"
+
+namespace PositionKey {
+
+// SYMMETRY TABLES
+
+// transformed[i] = board[SOURCE[s][i]] for each of the eight symmetries
+static const int SOURCE[SYMMETRIES][CELLS] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8}, // identity
+    {6, 3, 0, 7, 4, 1, 8, 5, 2}, // rotate 90
+    {8, 7, 6, 5, 4, 3, 2, 1, 0}, // rotate 180
+    {2, 5, 8, 1, 4, 7, 0, 3, 6}, // rotate 270
+    {2, 1, 0, 5, 4, 3, 8, 7, 6}, // mirror left-right
+    {6, 7, 8, 3, 4, 5, 0, 1, 2}, // mirror top-bottom
+    {0, 3, 6, 1, 4, 7, 2, 5, 8}, // main diagonal
+    {8, 5, 2, 7, 4, 1, 6, 3, 0}  // anti-diagonal
+};
+
+static int digit(char cell) {
+    return cell == 'X' ? 1 : cell == 'O' ? 2 : 0;
+}
+
+// KEYS
+
+int encode(const char* board) {
+    int key = 0;
+    for (int i = 0; i < CELLS; i++) {
+        key = key * 3 + digit(board[i]);
+    }
+    return key;
+}
+
+int encode(const char* board, int symmetry) {
+    int key = 0;
+    for (int i = 0; i < CELLS; i++) {
+        key = key * 3 + digit(board[SOURCE[symmetry][i]]);
+    }
+    return key;
+}
+
+int canonical(const char* board, int* symmetry) {
+    int best = -1;
+    int bestSymmetry = 0;
+
+    for (int s = 0; s < SYMMETRIES; s++) {
+        int key = encode(board, s);
+        if (best == -1 || key < best) {
+            best = key;
+            bestSymmetry = s;
+        }
+    }
+
+    if (symmetry) {
+        *symmetry = bestSymmetry;
+    }
+    return best;
+}
+
+int transformCell(int cell, int symmetry) {
+    // The cell whose source is `cell`
+    for (int i = 0; i < CELLS; i++) {
+        if (SOURCE[symmetry][i] == cell) {
+            return i;
+        }
+    }
+    return cell;
+}
+
+int inverseTransformCell(int cell, int symmetry) {
+    return SOURCE[symmetry][cell];
+}
+
+}
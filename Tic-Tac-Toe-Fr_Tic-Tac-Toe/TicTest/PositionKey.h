@@ -0,0 +1,32 @@
+#ifndef POSITIONKEY_H
+#define POSITIONKEY_H
+
+#include "MoveCodec.h"
+
+// Integer keys for 3x3 positions. A board is read as a base-3 number, one
+// digit per cell (' ' = 0, 'X' = 1, 'O' = 2, cell 0 most significant), so
+// every key is below 3^9. The canonical key is the smallest key over the
+// eight rotations and reflections of the board, which makes positions that
+// differ only by symmetry share one key.
+namespace PositionKey {
+
+const int CELLS = MoveCodec::BOARD_CELLS;
+const int SYMMETRIES = 8;
+const int KEY_COUNT = 19683; // 3^9
+
+int encode(const char* board);
+
+// Key of the board as seen under one symmetry
+int encode(const char* board, int symmetry);
+
+// Smallest key over all symmetries; if symmetry is given it receives the
+// transform that produced it, for use with transformCell
+int canonical(const char* board, int* symmetry = nullptr);
+
+// Where `cell` lands under `symmetry`, and back again
+int transformCell(int cell, int symmetry);
+int inverseTransformCell(int cell, int symmetry);
+
+}
+
+#endif // POSITIONKEY_H
@@ -0,0 +1,45 @@
+#include "ReplayTimeline.h"
+#include <algorithm>
+
+ReplayTimeline::ReplayTimeline() : boards(CELLS, ' '), plies(0) {
+}
+
+void ReplayTimeline::clear() {
+    boards.assign(CELLS, ' ');
+    plies = 0;
+}
+
+void ReplayTimeline::load(const MoveCodec::MoveView& moves) {
+    clear();
+    boards.reserve(static_cast<size_t>(moves.plyCount() + 1) * CELLS);
+
+    // Each frame is the previous one plus a single cell, so building all of
+    // them is linear in the number of moves
+    for (const MoveCodec::Move& move : moves) {
+        size_t previous = static_cast<size_t>(plies) * CELLS;
+        boards.resize(previous + 2 * CELLS);
+        std::copy_n(boards.begin() + previous, CELLS, boards.begin() + previous + CELLS);
+        boards[previous + CELLS + move.cell] = move.player;
+        plies++;
+    }
+}
+
+int ReplayTimeline::clampPly(int ply) const {
+    return std::max(0, std::min(ply, plies));
+}
+
+const char* ReplayTimeline::boardAt(int ply) const {
+    return boards.data() + static_cast<size_t>(clampPly(ply)) * CELLS;
+}
+
+int ReplayTimeline::diff(const char* shown, int ply, int* changedCells) const {
+    const char* target = boardAt(ply);
+    int count = 0;
+
+    for (int cell = 0; cell < CELLS; cell++) {
+        if (shown[cell] != target[cell]) {
+            changedCells[count++] = cell;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,35 @@
+#ifndef REPLAYTIMELINE_H
+#define REPLAYTIMELINE_H
+
+#include <vector>
+#include "MoveCodec.h"
+
+// Board state for every ply of a recorded game, built once when a replay is
+// loaded. Seeking is a lookup, and diff() reports just the cells that differ
+// from what a view currently shows so it only touches what changed.
+class ReplayTimeline {
+public:
+    static const int CELLS = MoveCodec::BOARD_CELLS;
+
+    ReplayTimeline();
+
+    void load(const MoveCodec::MoveView& moves);
+    void clear();
+
+    int plyCount() const { return plies; }
+
+    // CELLS chars ('X', 'O' or ' ') for the position after `ply` moves
+    const char* boardAt(int ply) const;
+
+    // Writes the indexes of cells where `shown` differs from the position
+    // after `ply` into changedCells (room for CELLS entries); returns the count
+    int diff(const char* shown, int ply, int* changedCells) const;
+
+private:
+    int clampPly(int ply) const;
+
+    std::vector<char> boards; // (plies + 1) * CELLS, ply 0 is the empty board
+    int plies;
+};
+
+#endif // REPLAYTIMELINE_H
@@ -0,0 +1,363 @@
+#include "SelfCheck.h"
+#include "GameArchive.h"
+#include "MoveCodec.h"
+#include "TicTacToeDB.h"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <exception>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace SelfCheck {
+
+namespace {
+
+const char* const PLAYERS[] = {"ana", "ben", "cleo"};
+const int PLAYER_COUNT = 3;
+const char* const MODES[] = {"Classic Mode", "Overwrite Mode", "AI Easy", "AI Hard"};
+const int MODE_COUNT = 4;
+
+// One game every 11 hours over the last 55 days, so the archive tier gets
+// about half of them and every grain has several buckets
+const int GAME_COUNT = 120;
+const int HOURS_APART = 11;
+const int ARCHIVE_DAYS = 30;
+
+// Memory databases live as long as a connection to them is open; the name
+// keeps the checks apart
+std::string location(const std::string& name) {
+    return "file:/selfcheck-" + name + "?vfs=memdb";
+}
+
+std::string timestampHoursAgo(int hours) {
+    std::time_t when = std::time(nullptr) - static_cast<std::time_t>(hours) * 3600;
+    char text[32];
+    std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", std::gmtime(&when));
+    return text;
+}
+
+// Game i of the history: players and mode rotate, and the result cycles
+// through a first player win, a second side win and a draw
+GameArchive::GameLine makeGame(int i) {
+    // Plies as cells, X first
+    static const std::vector<int> FIRST_WINS = {0, 3, 1, 4, 2};
+    static const std::vector<int> SECOND_WINS = {0, 3, 1, 4, 8, 5};
+    static const std::vector<int> DRAW = {0, 1, 2, 4, 3, 5, 7, 6, 8};
+
+    GameArchive::GameLine game;
+    game.timestamp = timestampHoursAgo((GAME_COUNT - i) * HOURS_APART);
+    game.gameMode = MODES[i % MODE_COUNT];
+    game.player1 = PLAYERS[i % PLAYER_COUNT];
+    bool againstAi = game.gameMode.compare(0, 2, "AI") == 0;
+    if (!againstAi) {
+        game.player2 = PLAYERS[(i + 1) % PLAYER_COUNT];
+    }
+
+    int result = i % 3;
+    const std::vector<int>& cells = result == 0 ? FIRST_WINS : result == 1 ? SECOND_WINS : DRAW;
+    game.winner = result == 0 ? '1' : result == 1 ? (againstAi ? 'A' : '2') : '-';
+
+    MoveCodec::Encoder encoder;
+    for (size_t ply = 0; ply < cells.size(); ply++) {
+        encoder.append(MoveCodec::playerForPly(static_cast<int>(ply)), cells[ply] / 3, cells[ply] % 3);
+    }
+    game.moveData = encoder.bytes();
+    game.plyCount = encoder.plyCount();
+    return game;
+}
+
+bool plays(const GameArchive::GameLine& game, const std::string& player) {
+    return !player.empty() && (game.player1 == player || game.player2 == player);
+}
+
+// Imports the history through importArchive, as a restore would. The
+// games of skipPlayer, and the player, are left out; newestFirst stores the
+// games in reverse, so their ids no longer follow play order.
+void populate(TicTacToeDB& database, const std::string& skipPlayer = "", bool newestFirst = false) {
+    std::ostringstream archive;
+    archive << GameArchive::HEADER << "\n";
+    for (const char* player : PLAYERS) {
+        if (player == skipPlayer) continue;
+
+        GameArchive::UserLine user;
+        user.username = player;
+        user.passwordHash = std::string(64, '0');
+        archive << GameArchive::formatUser(user) << "\n";
+    }
+
+    int expected = 0;
+    for (int n = 0; n < GAME_COUNT; n++) {
+        GameArchive::GameLine game = makeGame(newestFirst ? GAME_COUNT - 1 - n : n);
+        if (plays(game, skipPlayer)) continue;
+
+        archive << GameArchive::formatGame(game) << "\n";
+        expected++;
+    }
+
+    std::istringstream in(archive.str());
+    TicTacToeDB::ArchiveStats stats = database.importArchive(in);
+    if (stats.games != expected) {
+        throw std::runtime_error("imported " + std::to_string(stats.games) + " of " +
+                                 std::to_string(expected) + " games");
+    }
+}
+
+void archiveOldGames(TicTacToeDB& database) {
+    while (database.archiveGamesOlderThan(ARCHIVE_DAYS) > 0) {
+    }
+}
+
+// Every rollup row of every grain, one line each
+std::vector<std::string> rollupRows(TicTacToeDB& database) {
+    std::vector<std::string> rows;
+    for (TicTacToeDB::RollupGrain grain : {TicTacToeDB::HOURLY, TicTacToeDB::DAILY, TicTacToeDB::MONTHLY}) {
+        TicTacToeDB::RollupQuery query;
+        query.grain = grain;
+        for (const TicTacToeDB::RollupRow& row : database.queryRollups(query)) {
+            std::ostringstream line;
+            line << row.bucket << " " << row.gameMode << ": " << row.games << " games, " << row.totalMoves
+                 << " moves, " << row.player1Wins << "/" << row.player2Wins << "/" << row.aiWins << "/"
+                 << row.draws << " results";
+            rows.push_back(line.str());
+        }
+    }
+    return rows;
+}
+
+int rollupGames(TicTacToeDB& database) {
+    TicTacToeDB::RollupQuery query;
+    query.grain = TicTacToeDB::MONTHLY;
+    int games = 0;
+    for (const TicTacToeDB::RollupRow& row : database.queryRollups(query)) {
+        games += row.games;
+    }
+    return games;
+}
+
+// The whole leaderboard, one line per rated side. Sorted by name, since
+// equal ratings may rank in either order.
+std::vector<std::string> ratingRows(TicTacToeDB& database) {
+    std::vector<std::string> rows;
+    for (const TicTacToeDB::RatingEntry& entry : database.getLeaderboard(100)) {
+        char rating[32];
+        std::snprintf(rating, sizeof(rating), "%.6f", entry.rating);
+        rows.push_back(entry.name + " " + rating + ", " + std::to_string(entry.games) + " games, " +
+                       std::to_string(entry.wins) + "/" + std::to_string(entry.losses) + "/" +
+                       std::to_string(entry.draws) + " results");
+    }
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+// Empty if both lists match, else the first row that differs
+std::string compareRows(const std::vector<std::string>& kept, const std::vector<std::string>& expected) {
+    for (size_t i = 0; i < kept.size() || i < expected.size(); i++) {
+        std::string keptRow = i < kept.size() ? kept[i] : "(none)";
+        std::string expectedRow = i < expected.size() ? expected[i] : "(none)";
+        if (keptRow != expectedRow) {
+            return "row " + std::to_string(i + 1) + " is " + keptRow + ", expected " + expectedRow;
+        }
+    }
+    return "";
+}
+
+// CHECKS
+// Each returns an empty string on success, else what went wrong
+
+// Rollups kept by the import, the archive move and deletes from both tiers
+// match a recount of the games
+std::string checkRollups() {
+    TicTacToeDB database(location("rollups"));
+    populate(database);
+    archiveOldGames(database);
+
+    TicTacToeDB::HistoryQuery query;
+    query.userId = database.getUserId(PLAYERS[0]);
+    query.pageSize = GAME_COUNT;
+    std::vector<TicTacToeDB::GameRecord> games = database.queryGameHistory(query).games;
+    if (games.size() < 2) {
+        return "no history to delete from";
+    }
+    // The newest game is still hot, the oldest archived
+    database.deleteGame(games.front().id);
+    database.deleteGame(games.back().id);
+
+    std::vector<std::string> kept = rollupRows(database);
+    if (rollupGames(database) != GAME_COUNT - 2) {
+        return "rollups count " + std::to_string(rollupGames(database)) + " games, expected " +
+               std::to_string(GAME_COUNT - 2);
+    }
+
+    database.rebuildRollups();
+    return compareRows(kept, rollupRows(database));
+}
+
+// Every player's history, paged across both tiers, holds each of their
+// games once, newest first, and agrees with their statistics
+std::string checkHistory() {
+    TicTacToeDB database(location("history"));
+    populate(database);
+    archiveOldGames(database);
+
+    for (const char* player : PLAYERS) {
+        int expected = 0;
+        for (int i = 0; i < GAME_COUNT; i++) {
+            expected += plays(makeGame(i), player);
+        }
+
+        int userId = database.getUserId(player);
+        TicTacToeDB::UserStats stats = database.getUserStats(userId);
+
+        for (TicTacToeDB::ResultFilter result : {TicTacToeDB::ANY_RESULT, TicTacToeDB::WINS}) {
+            TicTacToeDB::HistoryQuery query;
+            query.userId = userId;
+            query.result = result;
+            query.pageSize = 7; // Several pages on each side of the tier boundary
+
+            std::vector<TicTacToeDB::GameRecord> games;
+            TicTacToeDB::HistoryPage page;
+            do {
+                page = database.queryGameHistory(query);
+                games.insert(games.end(), page.games.begin(), page.games.end());
+                query.after = page.next;
+            } while (page.hasMore && games.size() <= static_cast<size_t>(GAME_COUNT));
+
+            for (size_t i = 1; i < games.size(); i++) {
+                const TicTacToeDB::GameRecord& newer = games[i - 1];
+                const TicTacToeDB::GameRecord& older = games[i];
+                if (newer.timestamp < older.timestamp ||
+                    (newer.timestamp == older.timestamp && newer.id <= older.id)) {
+                    return std::string(player) + "'s game " + std::to_string(older.id) + " is out of order";
+                }
+            }
+
+            int want = result == TicTacToeDB::WINS ? stats.wins : expected;
+            if (static_cast<int>(games.size()) != want) {
+                return std::string(player) + " has " + std::to_string(games.size()) +
+                       (result == TicTacToeDB::WINS ? " wins" : " games") + " in history, expected " +
+                       std::to_string(want);
+            }
+        }
+
+        if (stats.totalGames != expected) {
+            return std::string(player) + "'s statistics count " + std::to_string(stats.totalGames) +
+                   " games, expected " + std::to_string(expected);
+        }
+    }
+    return "";
+}
+
+// A purge that is cut off halfway and resumed by another connection,
+// rating rebuild included, leaves the database as if the purged player had
+// never been imported
+std::string checkPurge() {
+    TicTacToeDB reference(location("purge-reference"));
+    populate(reference, PLAYERS[1]);
+    archiveOldGames(reference);
+
+    // Keeps the memory databases alive while the connection that starts
+    // the purge is closed, as when the game is quit mid-purge
+    TicTacToeDB holder(location("purge"));
+    populate(holder);
+    archiveOldGames(holder);
+    {
+        TicTacToeDB interrupted(location("purge"));
+        int userId = interrupted.getUserId(PLAYERS[1]);
+        interrupted.startPurge(userId, true);
+        interrupted.purgeStep(userId, 5);
+    }
+
+    TicTacToeDB database(location("purge"));
+    while (database.resumePurges(5) > 0) {
+    }
+    // Small batches, so the replay has to merge the tiers across many
+    while (database.resumeRatingRebuild(7) > 0) {
+    }
+
+    if (database.getUserId(PLAYERS[1]) != -1) {
+        return std::string("the account of ") + PLAYERS[1] + " is still there";
+    }
+
+    std::string problem = compareRows(rollupRows(database), rollupRows(reference));
+    if (!problem.empty()) {
+        return "rollups differ, " + problem;
+    }
+
+    problem = compareRows(ratingRows(database), ratingRows(reference));
+    if (!problem.empty()) {
+        return "ratings differ, " + problem;
+    }
+
+    for (const char* player : PLAYERS) {
+        if (player == PLAYERS[1]) continue;
+
+        TicTacToeDB::UserStats kept = database.getUserStats(database.getUserId(player));
+        TicTacToeDB::UserStats expected = reference.getUserStats(reference.getUserId(player));
+        if (kept.totalGames != expected.totalGames || kept.wins != expected.wins ||
+            kept.losses != expected.losses || kept.draws != expected.draws) {
+            return std::string(player) + "'s statistics differ";
+        }
+    }
+    return "";
+}
+
+// Ratings follow play order, not the order games were stored in: a history
+// imported newest first rates everyone as the same history imported in
+// order, both after the import and after recomputeRatings()
+std::string checkRatingOrder() {
+    TicTacToeDB inOrder(location("ratings-in-order"));
+    populate(inOrder);
+    TicTacToeDB reversed(location("ratings-reversed"));
+    populate(reversed, "", true);
+
+    std::string problem = compareRows(ratingRows(reversed), ratingRows(inOrder));
+    if (!problem.empty()) {
+        return "after the import, " + problem;
+    }
+
+    reversed.recomputeRatings();
+    problem = compareRows(ratingRows(reversed), ratingRows(inOrder));
+    if (!problem.empty()) {
+        return "after recomputeRatings, " + problem;
+    }
+    return "";
+}
+
+struct Check {
+    const char* name;
+    std::string (*run)();
+};
+
+const Check CHECKS[] = {
+    {"rollups after archiving and deletes", checkRollups},
+    {"history paged across both tiers", checkHistory},
+    {"purge resumed by another connection", checkPurge},
+    {"ratings replayed in play order", checkRatingOrder},
+};
+
+}
+
+int run(std::ostream& out) {
+    int failed = 0;
+    for (const Check& check : CHECKS) {
+        std::string problem;
+        try {
+            problem = check.run();
+        } catch (const std::exception& e) {
+            problem = e.what();
+        }
+
+        if (problem.empty()) {
+            out << check.name << ": ok" << std::endl;
+        } else {
+            out << check.name << ": FAILED, " << problem << std::endl;
+            failed++;
+        }
+    }
+    return failed;
+}
+
+}
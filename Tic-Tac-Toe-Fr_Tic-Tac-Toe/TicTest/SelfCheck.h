@@ -0,0 +1,18 @@
+#ifndef SELFCHECK_H
+#define SELFCHECK_H
+
+#include <ostream>
+
+// Consistency checks of the storage layer, run by --self-check. Each check
+// imports a small made-up history into a memory database of its own, drives
+// one feature the way the game does and compares the tables that feature
+// keeps current with a recount from scratch. The real database is never
+// opened.
+namespace SelfCheck {
+
+// Runs every check, one line each; returns how many failed
+int run(std::ostream& out);
+
+}
+
+#endif // SELFCHECK_H
@@ -0,0 +1,96 @@
+#include "SessionStore.h"
+#include "Sha256.h"
+#include <random>
+
+namespace {
+const int TOKEN_BYTES = 32;
+const char HEX_DIGITS[] = "0123456789abcdef";
+}
+
+constexpr std::chrono::minutes SessionStore::IDLE_TIMEOUT;
+
+std::string SessionStore::open(int userId, const std::string& username) {
+    std::random_device random;
+    std::string token;
+    token.reserve(TOKEN_BYTES * 2);
+    for (int i = 0; i < TOKEN_BYTES; i++) {
+        unsigned int byte = random() & 0xFF;
+        token += HEX_DIGITS[byte >> 4];
+        token += HEX_DIGITS[byte & 0xF];
+    }
+
+    Entry entry;
+    entry.session.userId = userId;
+    entry.session.username = username;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+    purgeExpired(now);
+    entry.expiresAt = now + IDLE_TIMEOUT;
+    sessions[digestOf(token)] = entry;
+    return token;
+}
+
+bool SessionStore::lookup(const std::string& token, Session& session) {
+    if (token.empty()) {
+        return false;
+    }
+    std::string digest = digestOf(token);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = sessions.find(digest);
+    if (it == sessions.end()) {
+        return false;
+    }
+
+    Clock::time_point now = Clock::now();
+    if (it->second.expiresAt <= now) {
+        sessions.erase(it);
+        return false;
+    }
+
+    it->second.expiresAt = now + IDLE_TIMEOUT;
+    session = it->second.session;
+    return true;
+}
+
+void SessionStore::close(const std::string& token) {
+    if (token.empty()) {
+        return;
+    }
+    std::string digest = digestOf(token);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    sessions.erase(digest);
+}
+
+void SessionStore::closeAllForUser(int userId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = sessions.begin(); it != sessions.end();) {
+        if (it->second.session.userId == userId) {
+            it = sessions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::string SessionStore::digestOf(const std::string& token) {
+    Sha256::Digest digest = Sha256::hash(token.data(), token.size());
+    return std::string(digest.begin(), digest.end());
+}
+
+void SessionStore::purgeExpired(Clock::time_point now) {
+    for (auto it = sessions.begin(); it != sessions.end();) {
+        if (it->second.expiresAt <= now) {
+            it = sessions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+SessionStore* SessionStore::getInstance() {
+    static SessionStore instance;
+    return &instance;
+}
@@ -0,0 +1,56 @@
+#ifndef SESSIONSTORE_H
+#define SESSIONSTORE_H
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Process-wide login sessions. Logging in issues a random token; windows that
+// act for the user hold the token and resolve it here instead of going back
+// to the users table. Sessions expire after IDLE_TIMEOUT without use and end
+// at logout or when the account is deleted.
+//
+// Only the SHA-256 of each token is kept. Lookups hash the presented token
+// first, so the time a lookup takes says nothing about how close a guess was.
+class SessionStore {
+public:
+    static constexpr std::chrono::minutes IDLE_TIMEOUT{120};
+
+    struct Session {
+        int userId = -1;
+        std::string username;
+    };
+
+    SessionStore(const SessionStore&) = delete;
+    SessionStore& operator=(const SessionStore&) = delete;
+
+    // Returns the new session's token
+    std::string open(int userId, const std::string& username);
+
+    // Fills session and extends its expiry if the token is live
+    bool lookup(const std::string& token, Session& session);
+
+    void close(const std::string& token);
+    void closeAllForUser(int userId);
+
+    static SessionStore* getInstance();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        Session session;
+        Clock::time_point expiresAt;
+    };
+
+    SessionStore() = default;
+
+    static std::string digestOf(const std::string& token);
+    void purgeExpired(Clock::time_point now);
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> sessions; // By token digest
+};
+
+#endif // SESSIONSTORE_H
@@ -0,0 +1,506 @@
+#include "Sha256.h"
+#include "picosha2.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <numeric>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace Sha256 {
+
+namespace {
+
+const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const uint32_t INITIAL_STATE[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+const int LANES = 8;
+
+inline uint32_t loadBigEndian(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+           static_cast<uint32_t>(p[2]) << 8 | static_cast<uint32_t>(p[3]);
+}
+
+inline void storeBigEndian(uint8_t* p, uint32_t value) {
+    p[0] = static_cast<uint8_t>(value >> 24);
+    p[1] = static_cast<uint8_t>(value >> 16);
+    p[2] = static_cast<uint8_t>(value >> 8);
+    p[3] = static_cast<uint8_t>(value);
+}
+
+inline uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+// Padding for a message of `size` bytes whose last partial block (size % 64
+// bytes) is `tail`. Writes one or two blocks to out and returns how many.
+size_t padTail(const uint8_t* tail, size_t size, uint8_t* out) {
+    size_t remaining = size % BLOCK_SIZE;
+    size_t blocks = remaining + 9 > BLOCK_SIZE ? 2 : 1;
+
+    std::memset(out, 0, blocks * BLOCK_SIZE);
+    std::memcpy(out, tail, remaining);
+    out[remaining] = 0x80;
+
+    uint64_t bits = static_cast<uint64_t>(size) * 8;
+    uint8_t* end = out + blocks * BLOCK_SIZE;
+    for (int i = 1; i <= 8; i++) {
+        end[-i] = static_cast<uint8_t>(bits >> (8 * (i - 1)));
+    }
+    return blocks;
+}
+
+// PORTABLE
+
+void compressPortable(uint32_t* state, const uint8_t* data, size_t blocks) {
+    uint32_t w[64];
+    for (; blocks > 0; blocks--, data += BLOCK_SIZE) {
+        for (int i = 0; i < 16; i++) {
+            w[i] = loadBigEndian(data + 4 * i);
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+#ifdef SHA256_X86
+
+// SHA-NI
+
+// Layout from Intel's SHA extensions paper: the state is kept as ABEF and
+// CDGH halves and every sha256rnds2 does two rounds
+__attribute__((target("sha,sse4.1")))
+void compressShaNi(uint32_t* state, const uint8_t* data, size_t blocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (; blocks > 0; blocks--, data += BLOCK_SIZE) {
+        __m128i saved0 = state0;
+        __m128i saved1 = state1;
+
+        // Four rounds per step; w holds the last four schedule vectors
+        __m128i w[4];
+        for (int step = 0; step < 16; step++) {
+            __m128i& current = w[step & 3];
+            if (step < 4) {
+                current = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * step)),
+                                           byteSwap);
+            } else {
+                __m128i previous = w[(step - 1) & 3];
+                __m128i mixed = _mm_add_epi32(_mm_sha256msg1_epu32(current, w[(step - 3) & 3]),
+                                              _mm_alignr_epi8(previous, w[(step - 2) & 3], 4));
+                current = _mm_sha256msg2_epu32(mixed, previous);
+            }
+
+            __m128i message = _mm_add_epi32(current, _mm_loadu_si128(reinterpret_cast<const __m128i*>(K + 4 * step)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(message, 0x0E));
+        }
+
+        state0 = _mm_add_epi32(state0, saved0);
+        state1 = _mm_add_epi32(state1, saved1);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+}
+
+// AVX2, EIGHT MESSAGES AT ONCE
+
+__attribute__((target("avx2")))
+inline __m256i rotate(__m256i x, int n) {
+    return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+// Lane i of every vector belongs to message i. Lanes without a block this
+// round compress a dummy block and keep their old state.
+__attribute__((target("avx2")))
+void compressAvx2x8(uint32_t states[LANES][8], const uint8_t* const blocks[LANES], int activeLanes) {
+    __m256i w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = _mm256_set_epi32(static_cast<int>(loadBigEndian(blocks[7] + 4 * i)),
+                                static_cast<int>(loadBigEndian(blocks[6] + 4 * i)),
+                                static_cast<int>(loadBigEndian(blocks[5] + 4 * i)),
+                                static_cast<int>(loadBigEndian(blocks[4] + 4 * i)),
+                                static_cast<int>(loadBigEndian(blocks[3] + 4 * i)),
+                                static_cast<int>(loadBigEndian(blocks[2] + 4 * i)),
+                                static_cast<int>(loadBigEndian(blocks[1] + 4 * i)),
+                                static_cast<int>(loadBigEndian(blocks[0] + 4 * i)));
+    }
+    for (int i = 16; i < 64; i++) {
+        __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotate(w[i - 15], 7), rotate(w[i - 15], 18)),
+                                      _mm256_srli_epi32(w[i - 15], 3));
+        __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotate(w[i - 2], 17), rotate(w[i - 2], 19)),
+                                      _mm256_srli_epi32(w[i - 2], 10));
+        w[i] = _mm256_add_epi32(_mm256_add_epi32(w[i - 16], s0), _mm256_add_epi32(w[i - 7], s1));
+    }
+
+    __m256i v[8];
+    for (int word = 0; word < 8; word++) {
+        v[word] = _mm256_set_epi32(static_cast<int>(states[7][word]), static_cast<int>(states[6][word]),
+                                   static_cast<int>(states[5][word]), static_cast<int>(states[4][word]),
+                                   static_cast<int>(states[3][word]), static_cast<int>(states[2][word]),
+                                   static_cast<int>(states[1][word]), static_cast<int>(states[0][word]));
+    }
+
+    __m256i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+    for (int i = 0; i < 64; i++) {
+        __m256i sigma1 = _mm256_xor_si256(_mm256_xor_si256(rotate(e, 6), rotate(e, 11)), rotate(e, 25));
+        __m256i choose = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, sigma1),
+                                      _mm256_add_epi32(_mm256_add_epi32(choose, w[i]),
+                                                       _mm256_set1_epi32(static_cast<int>(K[i]))));
+        __m256i sigma0 = _mm256_xor_si256(_mm256_xor_si256(rotate(a, 2), rotate(a, 13)), rotate(a, 22));
+        __m256i majority = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(a, c)),
+                                            _mm256_and_si256(b, c));
+        __m256i t2 = _mm256_add_epi32(sigma0, majority);
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi32(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm256_add_epi32(t1, t2);
+    }
+
+    __m256i result[8] = {
+        _mm256_add_epi32(v[0], a), _mm256_add_epi32(v[1], b), _mm256_add_epi32(v[2], c), _mm256_add_epi32(v[3], d),
+        _mm256_add_epi32(v[4], e), _mm256_add_epi32(v[5], f), _mm256_add_epi32(v[6], g), _mm256_add_epi32(v[7], h)
+    };
+    for (int word = 0; word < 8; word++) {
+        alignas(32) uint32_t lanes[LANES];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), result[word]);
+        for (int lane = 0; lane < LANES; lane++) {
+            if (activeLanes & (1 << lane)) {
+                states[lane][word] = lanes[lane];
+            }
+        }
+    }
+}
+
+#endif
+
+// DISPATCH
+
+struct Engines {
+    bool shaNi = false;
+    bool avx2 = false;
+};
+
+const Engines& engines() {
+    static const Engines detected = []() {
+        Engines found;
+#ifdef SHA256_X86
+        __builtin_cpu_init();
+        unsigned int eax, ebx, ecx, edx;
+        bool hasShaBit = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 29));
+        found.shaNi = hasShaBit && __builtin_cpu_supports("sse4.1");
+        found.avx2 = __builtin_cpu_supports("avx2");
+#endif
+        return found;
+    }();
+    return detected;
+}
+
+std::atomic<bool> accelerationEnabled(true);
+
+using CompressFunction = void (*)(uint32_t*, const uint8_t*, size_t);
+
+CompressFunction compressFunction() {
+#ifdef SHA256_X86
+    if (accelerationEnabled && engines().shaNi) {
+        return compressShaNi;
+    }
+#endif
+    return compressPortable;
+}
+
+bool useMultiBuffer() {
+    // SHA-NI on one message at a time beats eight AVX2 lanes
+    return accelerationEnabled && engines().avx2 && !engines().shaNi;
+}
+
+Digest digestOf(const uint32_t* state) {
+    Digest digest;
+    for (int i = 0; i < 8; i++) {
+        storeBigEndian(digest.data() + 4 * i, state[i]);
+    }
+    return digest;
+}
+
+#ifdef SHA256_X86
+
+// Up to LANES messages, all hashed to the end together
+void hashLanes(const std::vector<std::string>& inputs, const size_t* indices, int count,
+               std::vector<Digest>& digests) {
+    uint32_t states[LANES][8];
+    uint8_t tails[LANES][2 * BLOCK_SIZE];
+    size_t fullBlocks[LANES] = {};
+    size_t totalBlocks[LANES] = {};
+    static const uint8_t idleBlock[BLOCK_SIZE] = {};
+
+    size_t longest = 0;
+    for (int lane = 0; lane < count; lane++) {
+        const std::string& input = inputs[indices[lane]];
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(input.data());
+        std::copy(INITIAL_STATE, INITIAL_STATE + 8, states[lane]);
+        fullBlocks[lane] = input.size() / BLOCK_SIZE;
+        totalBlocks[lane] = fullBlocks[lane] +
+                            padTail(bytes + fullBlocks[lane] * BLOCK_SIZE, input.size(), tails[lane]);
+        longest = std::max(longest, totalBlocks[lane]);
+    }
+
+    for (size_t block = 0; block < longest; block++) {
+        const uint8_t* blocks[LANES];
+        int active = 0;
+        for (int lane = 0; lane < LANES; lane++) {
+            if (lane >= count || block >= totalBlocks[lane]) {
+                blocks[lane] = idleBlock;
+                continue;
+            }
+            active |= 1 << lane;
+            blocks[lane] = block < fullBlocks[lane]
+                               ? reinterpret_cast<const uint8_t*>(inputs[indices[lane]].data()) + block * BLOCK_SIZE
+                               : tails[lane] + (block - fullBlocks[lane]) * BLOCK_SIZE;
+        }
+        compressAvx2x8(states, blocks, active);
+    }
+
+    for (int lane = 0; lane < count; lane++) {
+        digests[indices[lane]] = digestOf(states[lane]);
+    }
+}
+
+#endif
+
+}
+
+// CONTEXT
+
+Context::Context() : buffered(0), length(0) {
+    std::copy(INITIAL_STATE, INITIAL_STATE + 8, state);
+}
+
+void Context::update(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    length += size;
+    CompressFunction compress = compressFunction();
+
+    if (buffered > 0) {
+        size_t take = std::min(size, BLOCK_SIZE - buffered);
+        std::memcpy(buffer + buffered, bytes, take);
+        buffered += take;
+        bytes += take;
+        size -= take;
+        if (buffered < BLOCK_SIZE) {
+            return;
+        }
+        compress(state, buffer, 1);
+        buffered = 0;
+    }
+
+    size_t blocks = size / BLOCK_SIZE;
+    if (blocks > 0) {
+        compress(state, bytes, blocks);
+        bytes += blocks * BLOCK_SIZE;
+        size -= blocks * BLOCK_SIZE;
+    }
+
+    std::memcpy(buffer, bytes, size);
+    buffered = size;
+}
+
+Digest Context::finish() {
+    uint8_t tail[2 * BLOCK_SIZE];
+    size_t blocks = padTail(buffer, static_cast<size_t>(length), tail);
+    compressFunction()(state, tail, blocks);
+    return digestOf(state);
+}
+
+// ONE-SHOT
+
+Digest hash(const void* data, size_t size) {
+    Context context;
+    context.update(data, size);
+    return context.finish();
+}
+
+std::string hashHex(const std::string& input) {
+    return toHex(hash(input.data(), input.size()));
+}
+
+std::string toHex(const Digest& digest) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(DIGEST_SIZE * 2);
+    for (uint8_t byte : digest) {
+        hex += digits[byte >> 4];
+        hex += digits[byte & 0xF];
+    }
+    return hex;
+}
+
+void hashBatch(const std::vector<std::string>& inputs, std::vector<Digest>& digests) {
+    digests.resize(inputs.size());
+
+#ifdef SHA256_X86
+    if (useMultiBuffer() && inputs.size() > 1) {
+        // Lanes of a group run until the longest message is done, so group
+        // messages of similar length
+        std::vector<size_t> order(inputs.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&inputs](size_t a, size_t b) {
+            return inputs[a].size() < inputs[b].size();
+        });
+
+        for (size_t start = 0; start < order.size(); start += LANES) {
+            int count = static_cast<int>(std::min<size_t>(LANES, order.size() - start));
+            hashLanes(inputs, order.data() + start, count, digests);
+        }
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < inputs.size(); i++) {
+        digests[i] = hash(inputs[i].data(), inputs[i].size());
+    }
+}
+
+void setAccelerationEnabled(bool enabled) {
+    accelerationEnabled = enabled;
+}
+
+const char* implementationName() {
+    return compressFunction() == compressPortable ? "portable" : "sha-ni";
+}
+
+const char* batchImplementationName() {
+    return useMultiBuffer() ? "avx2x8" : implementationName();
+}
+
+// BENCHMARK
+
+void runBenchmark(std::ostream& out) {
+    using Clock = std::chrono::steady_clock;
+    const int ROUNDS = 3;
+
+    // One large buffer, and many 55-byte messages (one block each, like
+    // the HMAC rounds in password hashing)
+    std::string large(8 << 20, '\0');
+    for (size_t i = 0; i < large.size(); i++) {
+        large[i] = static_cast<char>(i * 131 + 7);
+    }
+    std::vector<std::string> small(200000);
+    for (size_t i = 0; i < small.size(); i++) {
+        small[i] = std::string(55, static_cast<char>('a' + i % 26));
+        small[i][0] = static_cast<char>(i);
+        small[i][1] = static_cast<char>(i >> 8);
+    }
+    size_t smallBytes = small.size() * 55;
+
+    // Best of a few runs, in MB/s
+    auto measure = [&](const char* label, size_t bytes, const std::function<void()>& work) {
+        double best = 0;
+        for (int round = 0; round < ROUNDS; round++) {
+            auto start = Clock::now();
+            work();
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            best = std::max(best, bytes / 1e6 / std::max(seconds, 1e-9));
+        }
+        out << "  " << label << ": " << static_cast<int>(best) << " MB/s" << std::endl;
+    };
+
+    Digest sink = {};
+    auto consume = [&sink](const Digest& digest) { sink[0] ^= digest[0]; };
+
+    out << "SHA-256 throughput (hash: " << implementationName() << ", batch: " << batchImplementationName() << ")"
+        << std::endl;
+
+    out << "8 MB buffer" << std::endl;
+    measure("picosha2", large.size(), [&]() {
+        Digest digest;
+        picosha2::hash256(large.begin(), large.end(), digest.begin(), digest.end());
+        consume(digest);
+    });
+    for (bool accelerated : {false, true}) {
+        setAccelerationEnabled(accelerated);
+        measure(implementationName(), large.size(), [&]() { consume(hash(large.data(), large.size())); });
+    }
+
+    out << small.size() << " messages of 55 bytes" << std::endl;
+    measure("picosha2", smallBytes, [&]() {
+        Digest digest;
+        for (const std::string& message : small) {
+            picosha2::hash256(message.begin(), message.end(), digest.begin(), digest.end());
+            consume(digest);
+        }
+    });
+    std::vector<Digest> digests;
+    for (bool accelerated : {false, true}) {
+        setAccelerationEnabled(accelerated);
+        measure(implementationName(), smallBytes, [&]() {
+            for (const std::string& message : small) {
+                consume(hash(message.data(), message.size()));
+            }
+        });
+        measure((std::string("batch ") + batchImplementationName()).c_str(), smallBytes, [&]() {
+            hashBatch(small, digests);
+            consume(digests[0]);
+        });
+    }
+    setAccelerationEnabled(true);
+
+    // Printed so the work above can't be optimised away
+    out << "checksum " << static_cast<int>(sink[0]) << std::endl;
+}
+
+}
@@ -0,0 +1,59 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// SHA-256 with hardware paths picked at runtime. Single messages use the
+// SHA extensions (SHA-NI) when the CPU has them; hashBatch() runs eight
+// messages side by side in AVX2 registers when SHA-NI is missing. Every
+// other machine gets a portable word-at-a-time implementation. All paths
+// produce the same digests as picosha2, which stays in the tree as the
+// reference.
+namespace Sha256 {
+
+const size_t DIGEST_SIZE = 32;
+const size_t BLOCK_SIZE = 64;
+
+using Digest = std::array<uint8_t, DIGEST_SIZE>;
+
+// Incremental hashing. Plain data, so a context that has absorbed a prefix
+// can be copied and continued (HMAC keeps its padded key this way).
+class Context {
+public:
+    Context();
+
+    void update(const void* data, size_t size);
+    Digest finish();
+
+private:
+    uint32_t state[8];
+    uint8_t buffer[BLOCK_SIZE];
+    size_t buffered;
+    uint64_t length;
+};
+
+Digest hash(const void* data, size_t size);
+std::string hashHex(const std::string& input);
+std::string toHex(const Digest& digest);
+
+// Same digests as calling hash() on each input, faster for many inputs
+void hashBatch(const std::vector<std::string>& inputs, std::vector<Digest>& digests);
+
+// Off forces the portable path; for benchmarks and comparisons
+void setAccelerationEnabled(bool enabled);
+
+// Path hash() and hashBatch() take right now, e.g. "sha-ni" or "avx2x8"
+const char* implementationName();
+const char* batchImplementationName();
+
+// Throughput of every available path against picosha2, in MB/s
+void runBenchmark(std::ostream& out);
+
+}
+
+#endif // SHA256_H
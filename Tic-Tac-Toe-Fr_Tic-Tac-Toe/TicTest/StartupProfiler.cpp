@@ -0,0 +1,47 @@
+#include "StartupProfiler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+StartupProfiler::StartupProfiler() : lastMarkMs(0), reported(false) {
+    const char* setting = std::getenv("TICTACTOE_STARTUP_TIMINGS");
+    enabled = setting && *setting && std::string(setting) != "0";
+    clock.start();
+}
+
+void StartupProfiler::mark(const std::string& phase) {
+    std::lock_guard<std::mutex> lock(mutex);
+    qint64 now = clock.elapsed();
+    phases.push_back({phase, lastMarkMs, now - lastMarkMs});
+    lastMarkMs = now;
+}
+
+void StartupProfiler::record(const std::string& phase, qint64 startMs, qint64 durationMs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    phases.push_back({phase, startMs, durationMs});
+}
+
+void StartupProfiler::report() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!enabled || reported) {
+        return;
+    }
+    reported = true;
+
+    // Background spans overlap the GUI phases, so list everything by start time
+    std::vector<Phase> sorted = phases;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Phase& a, const Phase& b) {
+        return a.startMs < b.startMs;
+    });
+
+    std::cerr << "Startup timings (start +duration, ms):\n";
+    for (const Phase& phase : sorted) {
+        std::cerr << "  " << phase.startMs << " +" << phase.durationMs << "  " << phase.name << "\n";
+    }
+    std::cerr << "  total " << clock.elapsed() << std::endl;
+}
+
+StartupProfiler* StartupProfiler::getInstance() {
+    static StartupProfiler instance;
+    return &instance;
+}
@@ -0,0 +1,45 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QElapsedTimer>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Startup phase timings. The clock starts on the first getInstance() call
+// (top of main), mark() stamps a phase as it ends on the GUI thread, and
+// record() adds a span timed elsewhere, e.g. on the database thread. Only
+// reported when $TICTACTOE_STARTUP_TIMINGS is set.
+class StartupProfiler {
+private:
+    struct Phase {
+        std::string name;
+        qint64 startMs;
+        qint64 durationMs;
+    };
+
+    mutable std::mutex mutex;
+    QElapsedTimer clock;
+    qint64 lastMarkMs;
+    std::vector<Phase> phases;
+    bool enabled;
+    bool reported;
+
+    StartupProfiler();
+
+public:
+    StartupProfiler(const StartupProfiler&) = delete;
+    StartupProfiler& operator=(const StartupProfiler&) = delete;
+
+    qint64 elapsed() const { return clock.elapsed(); }
+
+    void mark(const std::string& phase);
+    void record(const std::string& phase, qint64 startMs, qint64 durationMs);
+
+    // Writes the breakdown to stderr once, if enabled
+    void report();
+
+    static StartupProfiler* getInstance();
+};
+
+#endif // STARTUPPROFILER_H
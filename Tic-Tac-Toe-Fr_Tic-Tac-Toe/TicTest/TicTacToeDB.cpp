@@ -1,18 +1,147 @@
 #include "TicTacToeDB.h"
-
-// Secure SHA-256 hash function using PicoSHA2
+#include "UserDirectory.h"
+#include "SessionStore.h"
+#include "WriteQueue.h"
+#include "GameArchive.h"
+#include "PasswordHasher.h"
+#include "Sha256.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+// Plain SHA-256 (see Sha256.h); also the unsalted password format of older
+// databases, which PasswordHasher still verifies
 string sha256Hash(const string& input) {
-    return picosha2::hash256_hex_string(input);
+    return Sha256::hashHex(input);
+}
+
+namespace {
+
+// Columns shared by games and archive.games, in archive order
+const char* const GAME_COLUMNS = "id, player1_id, player2_id, winner, moves, move_data, game_mode, game_duration, timestamp";
+
+const int LINES[8][3] = {
+    {0, 1, 2}, {3, 4, 5}, {6, 7, 8}, // rows
+    {0, 3, 6}, {1, 4, 7}, {2, 5, 8}, // columns
+    {0, 4, 8}, {2, 4, 6}             // diagonals
+};
+
+// 'X' or 'O' if that side has a line, ' ' otherwise
+char lineWinner(const char* board) {
+    for (const auto& line : LINES) {
+        if (board[line[0]] != ' ' && board[line[0]] == board[line[1]] && board[line[1]] == board[line[2]]) {
+            return board[line[0]];
+        }
+    }
+    return ' ';
+}
+
+// opening_stats buckets: mode 0 = Classic, 1 = Overwrite, 2 = AI (with
+// ai_level 1-3, as in AILevel); parsed the same way GameWindow::configure does
+void openingBucket(const string& gameMode, int& mode, int& aiLevel) {
+    mode = 0;
+    aiLevel = 0;
+    if (gameMode.find("AI") != string::npos) {
+        mode = 2;
+        aiLevel = gameMode.find("Medium") != string::npos ? 2 :
+                  gameMode.find("Hard") != string::npos ? 3 : 1;
+    } else if (gameMode.find("Overwrite") != string::npos) {
+        mode = 1;
+    }
+}
+
+// The same buckets in SQL, for statements that aggregate many games
+const char* const MODE_BUCKET_SQL =
+    "CASE WHEN instr(IFNULL(game_mode, ''), 'AI') > 0 THEN 2 "
+    "WHEN instr(IFNULL(game_mode, ''), 'Overwrite') > 0 THEN 1 ELSE 0 END";
+const char* const AI_LEVEL_SQL =
+    "CASE WHEN instr(IFNULL(game_mode, ''), 'AI') = 0 THEN 0 "
+    "WHEN instr(game_mode, 'Medium') > 0 THEN 2 "
+    "WHEN instr(game_mode, 'Hard') > 0 THEN 3 ELSE 1 END";
+
+// Display name of a bucket, in the form game_mode is stored
+string bucketName(int mode, int aiLevel) {
+    if (mode == 2) {
+        return aiLevel == 3 ? "AI Hard" : aiLevel == 2 ? "AI Medium" : "AI Easy";
+    }
+    return mode == 1 ? "Overwrite Mode" : "Classic Mode";
+}
+
+// The two rated sides of a game: player 1 against player 2 or the AI level.
+// Games against an unregistered opponent are not rated.
+bool ratedPlayers(int player1Id, int player2Id, const string& gameMode, int& first, int& second) {
+    int mode, aiLevel;
+    openingBucket(gameMode, mode, aiLevel);
+
+    first = player1Id;
+    if (mode == 2) {
+        second = TicTacToeDB::aiRatingId(aiLevel);
+        return true;
+    }
+    second = player2Id;
+    return player2Id > 0 && player2Id != player1Id;
+}
+
+// Player 1's result as an Elo score; winner 0 is a draw
+double scoreFor(int player1Id, int winner) {
+    if (winner == 0) {
+        return 0.5;
+    }
+    return winner == player1Id ? 1.0 : 0.0;
+}
+
+// Set once from the environment, or by setLocation()
+mutex locationMutex;
+string configuredLocation;
+
+bool isSharedCache(const string& location) {
+    return location.compare(0, 5, "file:") == 0 && location.find("cache=shared") != string::npos;
 }
 
-TicTacToeDB::TicTacToeDB() {
-    if (sqlite3_open("tictactoe.db", &db) != SQLITE_OK) {
-        throw runtime_error("Failed to open database");
+}
+
+TicTacToeDB::TicTacToeDB() : TicTacToeDB(location()) {
+}
+
+TicTacToeDB::TicTacToeDB(const string& location)
+    : databaseLocation(location), users(UserDirectory::forDatabase(location)), holdsWriteTurn(false) {
+    db = openConnection(location);
+
+    // Writers of this process take turns through WriteQueue; the handler
+    // covers other processes (the command line tools) and counts retries
+    sqlite3_busy_handler(db, busyHandler, nullptr);
+
+    // Lets MaintenanceScheduler hand free pages back in small steps. Only
+    // takes effect while the file is still empty, so it comes before WAL;
+    // older files convert with vacuum(), which MaintenanceScheduler runs by
+    // itself for small ones. The size limit cuts a WAL grown by a large
+    // import back down at the next checkpoint.
+    executeSQL("PRAGMA auto_vacuum = INCREMENTAL;");
+    executeSQL("PRAGMA journal_size_limit = " + to_string(JOURNAL_SIZE_LIMIT) + ";");
+
+    // Readers and the writer no longer block each other. The mode is stored
+    // in the file, so this only converts it on the first open; memory
+    // databases keep their own journal.
+    if (sqlite3_exec(db, "PRAGMA journal_mode = WAL;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        cerr << "Could not enable WAL: " << sqlite3_errmsg(db) << endl;
+    }
+
+    // Shared-cache tables are locked per table and readers would fail with
+    // SQLITE_LOCKED while a game is saved, which no busy handler retries
+    if (isSharedCache(location)) {
+        executeSQL("PRAGMA read_uncommitted = 1;");
     }
 
     // Enable foreign key support
     executeSQL("PRAGMA foreign_keys = ON;");
 
+    attachArchive();
+
     // Create users table for login functionality
     executeSQL("CREATE TABLE IF NOT EXISTS users ("
                "id INTEGER PRIMARY KEY AUTOINCREMENT, "
@@ -27,231 +156,2333 @@ TicTacToeDB::TicTacToeDB() {
                "player2_id INTEGER, "
                "winner INTEGER, "
                "moves TEXT, "
+               "move_data BLOB, "
                "game_mode TEXT DEFAULT 'Classic', "
                "game_duration INTEGER DEFAULT 0, "
                "timestamp DATETIME DEFAULT CURRENT_TIMESTAMP, "
                "FOREIGN KEY(player1_id) REFERENCES users(id) ON DELETE CASCADE, "
                "FOREIGN KEY(player2_id) REFERENCES users(id) ON DELETE CASCADE);");
+
+    migrateSchema();
+    finishPendingArchive();
+}
+
+TicTacToeDB::~TicTacToeDB() {
+    releaseWriteTurn();
+    sqlite3_close(db);
+}
+
+// LOCATION
+
+void TicTacToeDB::setLocation(const string& location) {
+    lock_guard<mutex> lock(locationMutex);
+    configuredLocation = location;
+}
+
+string TicTacToeDB::location() {
+    lock_guard<mutex> lock(locationMutex);
+    if (configuredLocation.empty()) {
+        const char* fromEnvironment = getenv("TICTACTOE_DB");
+        configuredLocation = fromEnvironment && *fromEnvironment ? fromEnvironment : "tictactoe.db";
+    }
+    return configuredLocation;
+}
+
+string TicTacToeDB::archiveLocation(const string& location) {
+    if (location.empty() || location == ":memory:") {
+        return ":memory:";
+    }
+
+    // URI parameters (vfs, mode, cache) carry over to the archive
+    bool uri = location.compare(0, 5, "file:") == 0;
+    size_t pathEnd = uri ? min(location.find('?'), location.size()) : location.size();
+    string path = location.substr(0, pathEnd);
+    string query = location.substr(pathEnd);
+
+    // The anonymous shared memory database needs a name of its own,
+    // otherwise the archive would attach the main database a second time
+    if (uri && path == "file::memory:") {
+        return "file:tictactoe_archive?mode=memory" + (query.empty() ? "" : "&" + query.substr(1));
+    }
+
+    if (path.size() > 3 && path.compare(path.size() - 3, 3, ".db") == 0) {
+        return path.substr(0, path.size() - 3) + "_archive.db" + query;
+    }
+    return path + "_archive" + query;
+}
+
+string TicTacToeDB::filePath(const string& location) {
+    if (location.empty() || location == ":memory:") {
+        return "";
+    }
+    if (location.compare(0, 5, "file:") != 0) {
+        return location;
+    }
+
+    size_t pathEnd = min(location.find('?'), location.size());
+    string path = location.substr(5, pathEnd - 5);
+    string query = "&" + location.substr(min(pathEnd + 1, location.size())) + "&";
+    if (path == ":memory:" || query.find("&mode=memory&") != string::npos ||
+        query.find("&vfs=memdb&") != string::npos) {
+        return "";
+    }
+
+    // file://host/path and file:///path; only a local authority is valid
+    if (path.compare(0, 2, "//") == 0) {
+        size_t slash = path.find('/', 2);
+        path = slash == string::npos ? "" : path.substr(slash);
+    }
+    return path;
+}
+
+sqlite3* TicTacToeDB::openConnection(const string& location) {
+    sqlite3* connection = nullptr;
+    if (sqlite3_open_v2(location.c_str(), &connection, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI,
+                        nullptr) != SQLITE_OK) {
+        string message = connection ? sqlite3_errmsg(connection) : "out of memory";
+        sqlite3_close(connection);
+        throw runtime_error("Failed to open database " + location + ": " + message);
+    }
+    return connection;
+}
+
+// BACKUP
+
+void TicTacToeDB::copyDatabase(sqlite3* source, const char* sourceName, sqlite3* target, const char* targetName) {
+    sqlite3_backup* backup = sqlite3_backup_init(target, targetName, source, sourceName);
+    if (!backup) {
+        throw runtime_error(string("Backup failed: ") + sqlite3_errmsg(target));
+    }
+
+    // Small steps; the source is only locked while a step runs, and a
+    // write from another connection simply makes the copy start over. A
+    // lock that outlasts TIMEOUT_MS without any step getting through ends
+    // the copy, since restoreFrom() holds the write turn meanwhile.
+    static const int RETRY_MS = 5;
+    static const int TIMEOUT_MS = 5000;
+
+    int result;
+    int blockedMs = 0;
+    while ((result = sqlite3_backup_step(backup, 256)) == SQLITE_OK ||
+           result == SQLITE_BUSY || result == SQLITE_LOCKED) {
+        if (result == SQLITE_OK) {
+            blockedMs = 0;
+        } else if (blockedMs >= TIMEOUT_MS) {
+            break;
+        } else {
+            sqlite3_sleep(RETRY_MS);
+            blockedMs += RETRY_MS;
+        }
+    }
+    sqlite3_backup_finish(backup);
+
+    if (result != SQLITE_DONE) {
+        throw runtime_error(string("Backup failed: ") + sqlite3_errstr(result));
+    }
+}
+
+void TicTacToeDB::backupTo(const string& location) {
+    const string targets[] = {location, archiveLocation(location)};
+    const char* sources[] = {"main", "archive"};
+
+    for (int i = 0; i < 2; i++) {
+        sqlite3* target = openConnection(targets[i]);
+        try {
+            copyDatabase(db, sources[i], target, "main");
+        } catch (const exception&) {
+            sqlite3_close(target);
+            throw;
+        }
+        sqlite3_close(target);
+    }
+}
+
+void TicTacToeDB::restoreFrom(const string& location) {
+    const string sourceLocations[] = {location, archiveLocation(location)};
+    const char* targets[] = {"main", "archive"};
+
+    // No transaction may be open on the target, so this takes the turn
+    // without BEGIN; other connections of the process wait meanwhile
+    if (holdsWriteTurn) {
+        throw runtime_error("Write transaction already open");
+    }
+    WriteQueue::getInstance()->acquire();
+    holdsWriteTurn = true;
+    try {
+        for (int i = 0; i < 2; i++) {
+            sqlite3* source = openConnection(sourceLocations[i]);
+            try {
+                copyDatabase(source, "main", db, targets[i]);
+            } catch (const exception&) {
+                sqlite3_close(source);
+                throw;
+            }
+            sqlite3_close(source);
+        }
+    } catch (const exception&) {
+        releaseWriteTurn();
+        throw;
+    }
+    releaseWriteTurn();
+
+    // Names and ids cached from the old contents no longer hold
+    users->clear();
+    migrateSchema();
+    finishPendingArchive();
+}
+
+// MAINTENANCE
+
+long long TicTacToeDB::pragmaValue(const string& pragma) {
+    sqlite3_stmt* stmt;
+    string sql = "PRAGMA " + pragma;
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        return -1;
+    }
+
+    long long value = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+bool TicTacToeDB::incrementalVacuumEnabled(const string& schema) {
+    return pragmaValue(schema + ".auto_vacuum") == 2;
+}
+
+int TicTacToeDB::freePages(const string& schema) {
+    return static_cast<int>(pragmaValue(schema + ".freelist_count"));
+}
+
+int TicTacToeDB::pageSize(const string& schema) {
+    return static_cast<int>(pragmaValue(schema + ".page_size"));
+}
+
+long long TicTacToeDB::fileSize(const string& schema) {
+    return pragmaValue(schema + ".page_count") * pageSize(schema);
+}
+
+int TicTacToeDB::incrementalVacuum(const string& schema, int pages) {
+    int before = freePages(schema);
+    if (before <= 0 || !incrementalVacuumEnabled(schema)) {
+        return 0;
+    }
+
+    beginWrite();
+    try {
+        executeSQL("PRAGMA " + schema + ".incremental_vacuum(" + to_string(pages) + ");");
+        commitWrite();
+    } catch (const exception&) {
+        rollbackWrite();
+        throw;
+    }
+
+    return before - freePages(schema);
+}
+
+void TicTacToeDB::optimize() {
+    // analysis_limit bounds the ANALYZE that optimize may run per index
+    beginWrite();
+    try {
+        executeSQL("PRAGMA analysis_limit = 400;");
+        executeSQL("PRAGMA optimize;");
+        commitWrite();
+    } catch (const exception&) {
+        rollbackWrite();
+        throw;
+    }
+}
+
+int TicTacToeDB::checkpoint(const string& schema) {
+    // Passive: copies what it can without waiting for readers or writers
+    int logFrames = 0;
+    int copiedFrames = 0;
+    if (sqlite3_wal_checkpoint_v2(db, schema.c_str(), SQLITE_CHECKPOINT_PASSIVE, &logFrames, &copiedFrames) != SQLITE_OK) {
+        return 0;
+    }
+    return max(copiedFrames, 0);
+}
+
+long long TicTacToeDB::vacuum() {
+    return vacuum("main") + vacuum("archive");
+}
+
+long long TicTacToeDB::vacuum(const string& schema) {
+    long long before = 0;
+    long long after = 0;
+
+    // VACUUM cannot run inside a transaction; the turn keeps the other
+    // connections of the process waiting instead of failing
+    if (holdsWriteTurn) {
+        throw runtime_error("Write transaction already open");
+    }
+    WriteQueue::getInstance()->acquire();
+    holdsWriteTurn = true;
+    try {
+        before = fileSize(schema);
+        // Rebuilding applies the auto_vacuum mode set when the connection opened
+        executeSQL("VACUUM " + schema + ";");
+        after = fileSize(schema);
+    } catch (const exception&) {
+        releaseWriteTurn();
+        throw;
+    }
+    releaseWriteTurn();
+
+    return before - after;
+}
+
+// WRITE TRANSACTIONS
+
+void TicTacToeDB::beginWrite() {
+    if (holdsWriteTurn) {
+        throw runtime_error("Write transaction already open");
+    }
+
+    WriteQueue::getInstance()->acquire();
+    holdsWriteTurn = true;
+    try {
+        executeSQL("BEGIN IMMEDIATE;");
+    } catch (const exception&) {
+        releaseWriteTurn();
+        throw;
+    }
+}
+
+void TicTacToeDB::commitWrite() {
+    // On failure the transaction is still open; the caller rolls back
+    executeSQL("COMMIT;");
+    releaseWriteTurn();
+}
+
+void TicTacToeDB::rollbackWrite() {
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+    releaseWriteTurn();
+}
+
+void TicTacToeDB::releaseWriteTurn() {
+    if (holdsWriteTurn) {
+        holdsWriteTurn = false;
+        WriteQueue::getInstance()->release();
+    }
+}
+
+int TicTacToeDB::busyHandler(void*, int retries) {
+    // Same back-off as sqlite3_busy_timeout, giving up after about 2 s
+    static const int DELAYS_MS[] = {1, 2, 5, 10, 15, 20, 25, 25, 25, 50, 50, 100};
+    static const int DELAY_COUNT = sizeof(DELAYS_MS) / sizeof(DELAYS_MS[0]);
+    static const int TIMEOUT_MS = 2000;
+
+    int waited = 0;
+    for (int i = 0; i < retries; i++) {
+        waited += DELAYS_MS[min(i, DELAY_COUNT - 1)];
+    }
+    if (waited >= TIMEOUT_MS) {
+        WriteQueue::getInstance()->recordBusyFailure();
+        return 0;
+    }
+
+    WriteQueue::getInstance()->recordBusyRetry();
+    sqlite3_sleep(DELAYS_MS[min(retries, DELAY_COUNT - 1)]);
+    return 1;
+}
+
+// SCHEMA MIGRATIONS
+
+void TicTacToeDB::migrateSchema() {
+    sqlite3_stmt* stmt;
+    int version = 0;
+
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            version = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    if (version < 1) {
+        // v1: moves are stored as a packed MoveCodec BLOB instead of text
+        beginWrite();
+        try {
+            if (!columnExists("games", "move_data")) {
+                executeSQL("ALTER TABLE games ADD COLUMN move_data BLOB;");
+            }
+            migrateLegacyMoves();
+            executeSQL("PRAGMA user_version = 1;");
+            commitWrite();
+        } catch (const exception&) {
+            rollbackWrite();
+            throw;
+        }
+    }
+
+    if (version < 2) {
+        // v2: per-player indexes backing keyset pagination in queryGameHistory
+        beginWrite();
+        try {
+            executeSQL("CREATE INDEX IF NOT EXISTS idx_games_player1 ON games(player1_id, timestamp, id);");
+            executeSQL("CREATE INDEX IF NOT EXISTS idx_games_player2 ON games(player2_id, timestamp, id);");
+            executeSQL("PRAGMA user_version = 2;");
+            commitWrite();
+        } catch (const exception&) {
+            rollbackWrite();
+            throw;
+        }
+    }
+
+    if (version < 3) {
+        // v3: games recovered from a crash journal; kept out of `games` so
+        // history and statistics only ever see finished games
+        beginWrite();
+        try {
+            executeSQL("CREATE TABLE IF NOT EXISTS abandoned_games ("
+                       "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                       "player1_id INTEGER NOT NULL, "
+                       "player2_id INTEGER, "
+                       "move_data BLOB, "
+                       "game_mode TEXT, "
+                       "ply_count INTEGER DEFAULT 0, "
+                       "last_move_at DATETIME, "
+                       "recovered_at DATETIME DEFAULT CURRENT_TIMESTAMP, "
+                       "FOREIGN KEY(player1_id) REFERENCES users(id) ON DELETE CASCADE, "
+                       "FOREIGN KEY(player2_id) REFERENCES users(id) ON DELETE CASCADE);");
+            executeSQL("PRAGMA user_version = 3;");
+            commitWrite();
+        } catch (const exception&) {
+            rollbackWrite();
+            throw;
+        }
+    }
+
+    if (version < 4) {
+        // v4: canonical position -> (game, ply) index. Games already stored
+        // are indexed later by backfillPositions(), up to the id recorded here.
+        beginWrite();
+        try {
+            executeSQL("CREATE TABLE IF NOT EXISTS positions ("
+                       "position_key INTEGER NOT NULL, "
+                       "game_id INTEGER NOT NULL REFERENCES games(id) ON DELETE CASCADE, "
+                       "ply INTEGER NOT NULL, "
+                       "PRIMARY KEY(position_key, game_id, ply)) WITHOUT ROWID;");
+            executeSQL("CREATE INDEX IF NOT EXISTS idx_positions_game ON positions(game_id);");
+            executeSQL("CREATE TABLE IF NOT EXISTS index_state ("
+                       "name TEXT PRIMARY KEY, "
+                       "last_id INTEGER NOT NULL DEFAULT 0, "
+                       "target_id INTEGER NOT NULL DEFAULT 0);");
+            executeSQL("INSERT OR IGNORE INTO index_state (name, last_id, target_id) "
+                       "SELECT 'positions', 0, IFNULL(MAX(id), 0) FROM games;");
+            executeSQL("PRAGMA user_version = 4;");
+            commitWrite();
+        } catch (const exception&) {
+            rollbackWrite();
+            throw;
+        }
+    }
+
+    if (version < 5) {
+        // v5: opening tree. One row per (bucket, canonical position, move in
+        // canonical orientation); saveGame keeps the counts current and
+        // backfillOpenings() adds the games stored before this version.
+        beginWrite();
+        try {
+            executeSQL("CREATE TABLE IF NOT EXISTS opening_stats ("
+                       "mode INTEGER NOT NULL, "
+                       "ai_level INTEGER NOT NULL, "
+                       "position_key INTEGER NOT NULL, "
+                       "move INTEGER NOT NULL, "
+                       "x_wins INTEGER NOT NULL DEFAULT 0, "
+                       "o_wins INTEGER NOT NULL DEFAULT 0, "
+                       "draws INTEGER NOT NULL DEFAULT 0, "
+                       "PRIMARY KEY(mode, ai_level, position_key, move)) WITHOUT ROWID;");
+            executeSQL("INSERT OR IGNORE INTO index_state (name, last_id, target_id) "
+                       "SELECT 'openings', 0, IFNULL(MAX(id), 0) FROM games;");
+            executeSQL("PRAGMA user_version = 5;");
+            commitWrite();
+        } catch (const exception&) {
+            rollbackWrite();
+            throw;
+        }
+    }
+
+    if (version < 6) {
+        // v6: Elo ratings. No foreign key since AI levels are rated too; the
+        // existing history is replayed once here.
+        beginWrite();
+        try {
+            executeSQL("CREATE TABLE IF NOT EXISTS ratings ("
+                       "player_id INTEGER PRIMARY KEY, "
+                       "rating REAL NOT NULL, "
+                       "games INTEGER NOT NULL DEFAULT 0, "
+                       "wins INTEGER NOT NULL DEFAULT 0, "
+                       "losses INTEGER NOT NULL DEFAULT 0, "
+                       "draws INTEGER NOT NULL DEFAULT 0);");
+            executeSQL("CREATE INDEX IF NOT EXISTS idx_ratings_rating ON ratings(rating DESC, player_id);");
+            executeSQL("DELETE FROM ratings;");
+            replayRatings();
+            executeSQL("PRAGMA user_version = 6;");
+            commitWrite();
+        } catch (const exception&) {
+            rollbackWrite();
+            throw;
+        }
+    }
+
+    if (version < 7) {
+        // v7: per-user results of archived games, so statistics never have
+        // to read the archive
+        beginWrite();
+        try {
+            executeSQL("CREATE TABLE IF NOT EXISTS archive_summary ("
+                       "user_id INTEGER PRIMARY KEY REFERENCES users(id) ON DELETE CASCADE, "
+                       "games INTEGER NOT NULL DEFAULT 0, "
+                       "wins INTEGER NOT NULL DEFAULT 0, "
+                       "losses INTEGER NOT NULL DEFAULT 0, "
+                       "draws INTEGER NOT NULL DEFAULT 0);");
+            executeSQL("PRAGMA user_version = 7;");
+            commitWrite();
+        } catch (const exception&) {
+            rollbackWrite();
+            throw;
+        }
+    }
+
+    if (version < 8) {
+        // v8: games per hour, day and month for every mode bucket, over
+        // both tiers. The existing history is counted once here.
+        beginWrite();
+        try {
+            executeSQL("CREATE TABLE IF NOT EXISTS game_rollups ("
+                       "grain INTEGER NOT NULL, "
+                       "bucket TEXT NOT NULL, "
+                       "mode INTEGER NOT NULL, "
+                       "ai_level INTEGER NOT NULL, "
+                       "games INTEGER NOT NULL DEFAULT 0, "
+                       "total_moves INTEGER NOT NULL DEFAULT 0, "
+                       "player1_wins INTEGER NOT NULL DEFAULT 0, "
+                       "player2_wins INTEGER NOT NULL DEFAULT 0, "
+                       "ai_wins INTEGER NOT NULL DEFAULT 0, "
+                       "draws INTEGER NOT NULL DEFAULT 0, "
+                       "PRIMARY KEY(grain, bucket, mode, ai_level)) WITHOUT ROWID;");
+            executeSQL("DELETE FROM game_rollups;");
+            countAllRollups();
+            executeSQL("PRAGMA user_version = 8;");
+            commitWrite();
+        } catch (const exception&) {
+            rollbackWrite();
+            throw;
+        }
+    }
+
+    if (version < 9) {
+        // v9: purges run in chunks and survive restarts (purge_jobs). The
+        // player indexes on abandoned_games keep the chunked deletes and the
+        // cascade from users off full scans.
+        beginWrite();
+        try {
+            executeSQL("CREATE TABLE IF NOT EXISTS purge_jobs ("
+                       "user_id INTEGER PRIMARY KEY, "
+                       "delete_account INTEGER NOT NULL DEFAULT 0, "
+                       "games_total INTEGER NOT NULL DEFAULT 0, "
+                       "games_deleted INTEGER NOT NULL DEFAULT 0, "
+                       "started_at DATETIME DEFAULT CURRENT_TIMESTAMP);");
+            executeSQL("CREATE INDEX IF NOT EXISTS idx_abandoned_player1 ON abandoned_games(player1_id);");
+            executeSQL("CREATE INDEX IF NOT EXISTS idx_abandoned_player2 ON abandoned_games(player2_id);");
+            executeSQL("PRAGMA user_version = 9;");
+            commitWrite();
+        } catch (const exception&) {
+            rollbackWrite();
+            throw;
+        }
+    }
+
+    if (version < 10) {
+        // v10: archiving batches are recorded in the hot database before
+        // anything moves, and finished (never undone) by whoever finds them.
+        // Games an earlier version left in both tiers join the record.
+        beginWrite();
+        try {
+            executeSQL("CREATE TABLE IF NOT EXISTS archive_pending (id INTEGER PRIMARY KEY);");
+            executeSQL("INSERT OR IGNORE INTO archive_pending (id) "
+                       "SELECT id FROM main.games WHERE id IN (SELECT id FROM archive.games);");
+            executeSQL("PRAGMA user_version = 10;");
+            commitWrite();
+        } catch (const exception&) {
+            rollbackWrite();
+            throw;
+        }
+    }
+
+    if (version < 11) {
+        // v11: rating rebuilds run in batches (rating_rebuild holds the
+        // cursor, rating_shadow the ratings so far) and seek hot games in
+        // play order through idx_games_timestamp
+        beginWrite();
+        try {
+            executeSQL("CREATE TABLE IF NOT EXISTS rating_rebuild ("
+                       "id INTEGER PRIMARY KEY CHECK (id = 1), "
+                       "after_timestamp TEXT NOT NULL DEFAULT '', "
+                       "after_id INTEGER NOT NULL DEFAULT 0);");
+            executeSQL("CREATE TABLE IF NOT EXISTS rating_shadow ("
+                       "player_id INTEGER PRIMARY KEY, "
+                       "rating REAL NOT NULL, "
+                       "games INTEGER NOT NULL DEFAULT 0, "
+                       "wins INTEGER NOT NULL DEFAULT 0, "
+                       "losses INTEGER NOT NULL DEFAULT 0, "
+                       "draws INTEGER NOT NULL DEFAULT 0);");
+            executeSQL("CREATE INDEX IF NOT EXISTS idx_games_timestamp ON games(timestamp);");
+            executeSQL("PRAGMA user_version = 11;");
+            commitWrite();
+        } catch (const exception&) {
+            rollbackWrite();
+            throw;
+        }
+    }
+
+    if (version < 12) {
+        // v12: settings that belong to the database rather than one run,
+        // such as the password hash cost
+        beginWrite();
+        try {
+            executeSQL("CREATE TABLE IF NOT EXISTS settings ("
+                       "name TEXT PRIMARY KEY, "
+                       "value TEXT NOT NULL);");
+            executeSQL("PRAGMA user_version = 12;");
+            commitWrite();
+        } catch (const exception&) {
+            rollbackWrite();
+            throw;
+        }
+    }
+}
+
+void TicTacToeDB::attachArchive() {
+    // Cold tier filled by archiveGamesOlderThan(). A separate file keeps the
+    // hot database small; the tables are recreated if the file goes missing.
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "ATTACH DATABASE ? AS archive", -1, &stmt, nullptr) != SQLITE_OK) {
+        throw runtime_error("Failed to prepare archive attach");
+    }
+    string archive = archiveLocation(databaseLocation);
+    sqlite3_bind_text(stmt, 1, archive.c_str(), -1, SQLITE_TRANSIENT);
+    int attached = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (attached != SQLITE_DONE) {
+        cerr << "SQL error: " << sqlite3_errmsg(db) << endl;
+        throw runtime_error("Failed to attach archive " + archive);
+    }
+    executeSQL("PRAGMA archive.auto_vacuum = INCREMENTAL;");
+    executeSQL("PRAGMA archive.journal_size_limit = " + to_string(JOURNAL_SIZE_LIMIT) + ";");
+    if (sqlite3_exec(db, "PRAGMA archive.journal_mode = WAL;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        cerr << "Could not enable WAL for the archive: " << sqlite3_errmsg(db) << endl;
+    }
+    executeSQL("CREATE TABLE IF NOT EXISTS archive.games ("
+               "id INTEGER PRIMARY KEY, "
+               "player1_id INTEGER NOT NULL, "
+               "player2_id INTEGER, "
+               "winner INTEGER, "
+               "moves TEXT, "
+               "move_data BLOB, "
+               "game_mode TEXT, "
+               "game_duration INTEGER DEFAULT 0, "
+               "timestamp DATETIME);");
+    executeSQL("CREATE INDEX IF NOT EXISTS archive.idx_archive_player1 ON games(player1_id, timestamp, id);");
+    executeSQL("CREATE INDEX IF NOT EXISTS archive.idx_archive_player2 ON games(player2_id, timestamp, id);");
+    executeSQL("CREATE INDEX IF NOT EXISTS archive.idx_archive_timestamp ON games(timestamp);");
+    executeSQL("CREATE TABLE IF NOT EXISTS archive.positions ("
+               "position_key INTEGER NOT NULL, "
+               "game_id INTEGER NOT NULL, "
+               "ply INTEGER NOT NULL, "
+               "PRIMARY KEY(position_key, game_id, ply)) WITHOUT ROWID;");
+    executeSQL("CREATE INDEX IF NOT EXISTS archive.idx_archive_positions_game ON positions(game_id);");
+}
+
+int TicTacToeDB::finishPendingArchive() {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT EXISTS (SELECT 1 FROM main.archive_pending)", -1, &stmt, nullptr) != SQLITE_OK) {
+        return 0;
+    }
+    bool pending = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) != 0;
+    sqlite3_finalize(stmt);
+    if (!pending) {
+        return 0;
+    }
+
+    // With WAL, a transaction over both files is only atomic per file, so
+    // the copy and the hot delete commit separately. Each step works only
+    // from what the previous one left behind and can be repeated, so a
+    // batch comes out the same whether one connection finishes it or a run
+    // stops halfway and another connection picks it up.
+    const string batch = "id IN (SELECT id FROM main.archive_pending)";
+    beginWrite();
+    try {
+        // Rows and their positions move as they are; the opening tree and
+        // ratings already count them and stay untouched
+        executeSQL("INSERT OR IGNORE INTO archive.games (" + string(GAME_COLUMNS) + ") "
+                   "SELECT " + string(GAME_COLUMNS) + " FROM main.games WHERE " + batch + ";");
+        executeSQL("INSERT OR IGNORE INTO archive.positions (position_key, game_id, ply) "
+                   "SELECT position_key, game_id, ply FROM main.positions "
+                   "WHERE game_id IN (SELECT id FROM main.archive_pending);");
+        commitWrite();
+    } catch (const exception&) {
+        rollbackWrite();
+        throw;
+    }
+
+    // Only hot rows whose copy is committed leave; games deleted in the
+    // meantime are gone from both tiers and just drop off the record
+    const string copied = batch + " AND id IN (SELECT id FROM archive.games)";
+    int moved = 0;
+    beginWrite();
+    try {
+        adjustArchiveSummary("main.games", copied, 0, 1);
+
+        // Hot positions follow through ON DELETE CASCADE
+        executeSQL("DELETE FROM main.games WHERE " + copied + ";");
+        moved = sqlite3_changes(db);
+        executeSQL("DELETE FROM main.archive_pending WHERE id NOT IN (SELECT id FROM main.games);");
+        commitWrite();
+    } catch (const exception&) {
+        rollbackWrite();
+        throw;
+    }
+    return moved;
+}
+
+bool TicTacToeDB::columnExists(const string& table, const string& column) {
+    sqlite3_stmt* stmt;
+    string sql = "PRAGMA table_info(" + table + ")";
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+
+    bool found = false;
+    while (!found && sqlite3_step(stmt) == SQLITE_ROW) {
+        found = column == reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+    }
+
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+void TicTacToeDB::migrateLegacyMoves() {
+    sqlite3_stmt* selectStmt;
+    sqlite3_stmt* updateStmt;
+    string selectSql = "SELECT id, moves FROM games "
+                       "WHERE move_data IS NULL AND moves IS NOT NULL AND id > ? "
+                       "ORDER BY id LIMIT 256";
+    string updateSql = "UPDATE games SET move_data = ?, moves = NULL WHERE id = ?";
+
+    if (sqlite3_prepare_v2(db, selectSql.c_str(), -1, &selectStmt, nullptr) != SQLITE_OK) {
+        throw runtime_error("Failed to prepare move migration");
+    }
+    if (sqlite3_prepare_v2(db, updateSql.c_str(), -1, &updateStmt, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(selectStmt);
+        throw runtime_error("Failed to prepare move migration");
+    }
+
+    // Walk the table in id batches so updates never race the open cursor
+    vector<pair<int, string>> batch;
+    vector<uint8_t> encoded;
+    int lastId = 0;
+
+    do {
+        batch.clear();
+        sqlite3_bind_int(selectStmt, 1, lastId);
+        while (sqlite3_step(selectStmt) == SQLITE_ROW) {
+            batch.emplace_back(sqlite3_column_int(selectStmt, 0),
+                               reinterpret_cast<const char*>(sqlite3_column_text(selectStmt, 1)));
+        }
+        sqlite3_reset(selectStmt);
+
+        for (const auto& row : batch) {
+            lastId = row.first;
+
+            // Rows that cannot be packed keep their text so nothing is lost
+            if (!MoveCodec::encodeLegacy(row.second, encoded)) {
+                cerr << "Keeping legacy moves for game " << row.first << "\n";
+                continue;
+            }
+
+            sqlite3_bind_blob(updateStmt, 1, encoded.data(), static_cast<int>(encoded.size()), SQLITE_TRANSIENT);
+            sqlite3_bind_int(updateStmt, 2, row.first);
+            sqlite3_step(updateStmt);
+            sqlite3_reset(updateStmt);
+        }
+    } while (!batch.empty());
+
+    sqlite3_finalize(selectStmt);
+    sqlite3_finalize(updateStmt);
+}
+
+void TicTacToeDB::readMoveColumns(sqlite3_stmt* stmt, int blobColumn, int textColumn, vector<uint8_t>& out) {
+    out.clear();
+
+    if (sqlite3_column_type(stmt, blobColumn) != SQLITE_NULL) {
+        const uint8_t* blob = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, blobColumn));
+        out.assign(blob, blob + sqlite3_column_bytes(stmt, blobColumn));
+    } else if (sqlite3_column_type(stmt, textColumn) != SQLITE_NULL) {
+        MoveCodec::encodeLegacy(reinterpret_cast<const char*>(sqlite3_column_text(stmt, textColumn)), out);
+    }
+}
+
+// LOGIN FUNCTIONALITY
+
+bool TicTacToeDB::acceptableCredentials(const string& username, const string& password) {
+    if (username.empty() || password.empty()) {
+        cerr << "Username and password cannot be empty\n";
+        return false;
+    }
+
+    if (password.length() < 4) {
+        cerr << "Password must be at least 4 characters long\n";
+        return false;
+    }
+    return true;
+}
+
+bool TicTacToeDB::createUser(const string& username, const string& password) {
+    if (!acceptableCredentials(username, password)) {
+        return false;
+    }
+    return createUserWithHash(username, PasswordHasher::hash(password));
+}
+
+bool TicTacToeDB::createUserWithHash(const string& username, const string& passwordHash) {
+    if (username.empty() || passwordHash.empty()) {
+        return false;
+    }
+
+    // Check if username already exists
+    if (userExists(username)) {
+        cerr << "Username already exists: " << username << "\n";
+        return false;
+    }
+
+    sqlite3_stmt* stmt;
+    string insertSql = "INSERT INTO users (username, password_hash) VALUES (?, ?)";
+
+    if (sqlite3_prepare_v2(db, insertSql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        cerr << "Failed to prepare insert statement\n";
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, passwordHash.c_str(), -1, SQLITE_TRANSIENT);
+
+    bool result = sqlite3_step(stmt) == SQLITE_DONE;
+    if (result) {
+        users->remember(static_cast<int>(sqlite3_last_insert_rowid(db)), username);
+    } else {
+        cerr << "Error creating user '" << username << "'\n";
+    }
+
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+bool TicTacToeDB::validateUser(const string& username, const string& password) {
+    if (username.empty() || password.empty()) {
+        return false;
+    }
+
+    int userId;
+    string storedHash;
+    if (!getPasswordHash(username, userId, storedHash)) {
+        return false;
+    }
+
+    if (!PasswordHasher::verify(password, storedHash)) {
+        return false;
+    }
+
+    // Upgrade legacy and cheaper hashes while the password is at hand
+    if (PasswordHasher::needsRehash(storedHash)) {
+        replacePasswordHash(userId, storedHash, PasswordHasher::hash(password));
+    }
+    return true;
+}
+
+bool TicTacToeDB::getPasswordHash(const string& username, int& userId, string& passwordHash) {
+    sqlite3_stmt* stmt;
+    string sql = "SELECT password_hash, id FROM users WHERE username = ?";
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    if (found) {
+        passwordHash = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        userId = sqlite3_column_int(stmt, 1);
+        users->remember(userId, username);
+    }
+
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+bool TicTacToeDB::replacePasswordHash(int userId, const string& oldHash, const string& newHash) {
+    sqlite3_stmt* stmt;
+    // Only if nothing changed the password since oldHash was read
+    string sql = "UPDATE users SET password_hash = ? WHERE id = ? AND password_hash = ?";
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, newHash.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, userId);
+    sqlite3_bind_text(stmt, 3, oldHash.c_str(), -1, SQLITE_TRANSIENT);
+
+    bool result = sqlite3_step(stmt) == SQLITE_DONE && sqlite3_changes(db) == 1;
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+int TicTacToeDB::raisePasswordCost(int calibrated) {
+    sqlite3_stmt* stmt;
+    int cost = 0;
+
+    beginWrite();
+    try {
+        if (sqlite3_prepare_v2(db, "SELECT CAST(value AS INTEGER) FROM settings WHERE name = 'password_cost'", -1,
+                               &stmt, nullptr) != SQLITE_OK) {
+            throw runtime_error("Failed to prepare password cost query");
+        }
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            cost = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+
+        if (calibrated > cost) {
+            cost = calibrated;
+            if (sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO settings (name, value) VALUES ('password_cost', ?)",
+                                   -1, &stmt, nullptr) != SQLITE_OK) {
+                throw runtime_error("Failed to prepare password cost update");
+            }
+            sqlite3_bind_int(stmt, 1, cost);
+            bool stored = sqlite3_step(stmt) == SQLITE_DONE;
+            sqlite3_finalize(stmt);
+            if (!stored) {
+                throw runtime_error("Failed to store password cost");
+            }
+        }
+        commitWrite();
+    } catch (const exception&) {
+        rollbackWrite();
+        throw;
+    }
+    return cost;
+}
+
+bool TicTacToeDB::userExists(const string& username) {
+    int cachedId;
+    if (users->lookupId(username, cachedId)) {
+        return true;
+    }
+
+    sqlite3_stmt* stmt;
+    string checkSql = "SELECT id FROM users WHERE username = ?";
+
+    if (sqlite3_prepare_v2(db, checkSql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+    bool exists = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+
+    return exists;
+}
+
+int TicTacToeDB::getUserId(const string& username) {
+    int userId = -1;
+    if (users->lookupId(username, userId)) {
+        return userId;
+    }
+
+    sqlite3_stmt* stmt;
+    string sql = "SELECT id FROM users WHERE username = ?";
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        return -1;
+    }
+
+    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        userId = sqlite3_column_int(stmt, 0);
+        users->remember(userId, username);
+    }
+
+    sqlite3_finalize(stmt);
+    return userId;
+}
+
+string TicTacToeDB::getUsernameById(int userId) {
+    string username = "Unknown";
+    if (users->lookupName(userId, username)) {
+        return username;
+    }
+
+    sqlite3_stmt* stmt;
+    string sql = "SELECT username FROM users WHERE id = ?";
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        return "Unknown";
+    }
+
+    sqlite3_bind_int(stmt, 1, userId);
+
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        users->remember(userId, username);
+    }
+
+    sqlite3_finalize(stmt);
+    return username;
+}
+
+bool TicTacToeDB::deleteUser(const string& username) {
+    int userId = getUserId(username);
+    if (userId == -1) {
+        cerr << "Failed to delete user or user not found\n";
+        return false;
+    }
+
+    // The user's games go first in chunks, each taking back its share of
+    // the derived tables; the account row goes with the last step
+    try {
+        purgeUser(userId, true);
+    } catch (const exception& e) {
+        cerr << "Failed to delete user: " << e.what() << endl;
+        return false;
+    }
+    return true;
+}
+
+// HISTORY FUNCTIONALITY
+
+void TicTacToeDB::saveGame(int player1Id, int player2Id, int winner, const vector<string>& moves, const string& gameMode) {
+    vector<uint8_t> moveData;
+    if (!MoveCodec::encodeLegacy(moves, moveData)) {
+        throw runtime_error("Failed to encode moves");
+    }
+
+    saveGame(player1Id, player2Id, winner, moveData, static_cast<int>(moves.size()), gameMode);
+}
+
+void TicTacToeDB::saveGame(int player1Id, int player2Id, int winner, const vector<uint8_t>& moveData, int plyCount, const string& gameMode) {
+    // The game and everything derived from it commit together
+    beginWrite();
+    try {
+        int gameId = insertGame(player1Id, player2Id, winner, moveData, plyCount, gameMode);
+        indexPositions(gameId, moveData);
+        recordOpenings(moveData, gameMode, 1);
+        updateRatings(player1Id, player2Id, winner, gameMode);
+        adjustRollups("games", "id = ?1", gameId, 1);
+        commitWrite();
+    } catch (const exception&) {
+        rollbackWrite();
+        throw;
+    }
+}
+
+int TicTacToeDB::insertGame(int player1Id, int player2Id, int winner, const vector<uint8_t>& moveData, int plyCount, const string& gameMode) {
+    sqlite3_stmt* stmt;
+    string sql = "INSERT INTO games (player1_id, player2_id, winner, move_data, game_mode, game_duration) VALUES (?, ?, ?, ?, ?, ?)";
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        throw runtime_error("Failed to prepare statement");
+    }
+
+    sqlite3_bind_int(stmt, 1, player1Id);
+    player2Id == -1 ? sqlite3_bind_null(stmt, 2) : sqlite3_bind_int(stmt, 2, player2Id);
+    winner == 0 ? sqlite3_bind_null(stmt, 3) : sqlite3_bind_int(stmt, 3, winner);
+    sqlite3_bind_blob(stmt, 4, moveData.data(), static_cast<int>(moveData.size()), SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 5, gameMode.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 6, plyCount); // Game duration as number of moves
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        sqlite3_finalize(stmt);
+        throw runtime_error("Failed to save game");
+    }
+
+    sqlite3_finalize(stmt);
+    return static_cast<int>(sqlite3_last_insert_rowid(db));
+}
+
+// POSITION INDEX
+
+void TicTacToeDB::indexPositions(int gameId, const vector<uint8_t>& moveData) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO positions (position_key, game_id, ply) VALUES (?, ?, ?)",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        throw runtime_error("Failed to prepare position insert");
+    }
+
+    // Replay the game once; every position after a move becomes one row
+    char board[PositionKey::CELLS] = {' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '};
+    int ply = 0;
+    for (const MoveCodec::Move& move : MoveCodec::MoveView(moveData)) {
+        board[move.cell] = move.player;
+        ply++;
+
+        sqlite3_bind_int(stmt, 1, PositionKey::canonical(board));
+        sqlite3_bind_int(stmt, 2, gameId);
+        sqlite3_bind_int(stmt, 3, ply);
+
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            sqlite3_finalize(stmt);
+            throw runtime_error("Failed to index positions");
+        }
+        sqlite3_reset(stmt);
+    }
+
+    sqlite3_finalize(stmt);
+}
+
+int TicTacToeDB::backfillPositions(int batchSize) {
+    return backfill("positions", batchSize,
+                    [this](int gameId, const vector<uint8_t>& moveData, const string&) {
+                        indexPositions(gameId, moveData);
+                    });
+}
+
+int TicTacToeDB::visitGames(int afterId, int upToId, int limit, const GameVisitor& visit, int& lastId) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT id, move_data, moves, game_mode FROM games "
+                               "WHERE id > ? AND id <= ? ORDER BY id LIMIT ?",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        throw runtime_error("Failed to prepare game scan");
+    }
+    sqlite3_bind_int(stmt, 1, afterId);
+    sqlite3_bind_int(stmt, 2, upToId);
+    sqlite3_bind_int(stmt, 3, limit);
+
+    // Read the whole batch first so visit() may write to the database
+    struct PendingGame {
+        int id;
+        vector<uint8_t> moveData;
+        string gameMode;
+    };
+    vector<PendingGame> batch;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        PendingGame game;
+        game.id = sqlite3_column_int(stmt, 0);
+        readMoveColumns(stmt, 1, 2, game.moveData);
+        game.gameMode = sqlite3_column_type(stmt, 3) == SQLITE_NULL ?
+                            "Classic" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+        batch.push_back(std::move(game));
+    }
+    sqlite3_finalize(stmt);
+
+    for (const PendingGame& game : batch) {
+        visit(game.id, game.moveData, game.gameMode);
+    }
+
+    lastId = batch.empty() ? afterId : batch.back().id;
+    return static_cast<int>(batch.size());
+}
+
+int TicTacToeDB::backfill(const char* indexName, int batchSize, const GameVisitor& indexGame) {
+    sqlite3_stmt* stmt;
+    int lastId = 0;
+    int targetId = 0;
+
+    if (sqlite3_prepare_v2(db, "SELECT last_id, target_id FROM index_state WHERE name = ?",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        return 0;
+    }
+    sqlite3_bind_text(stmt, 1, indexName, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        lastId = sqlite3_column_int(stmt, 0);
+        targetId = sqlite3_column_int(stmt, 1);
+    }
+    sqlite3_finalize(stmt);
+
+    if (lastId >= targetId) {
+        return 0;
+    }
+
+    // One batch per transaction so live saves are never blocked for long
+    int indexed = 0;
+    beginWrite();
+    try {
+        indexed = visitGames(lastId, targetId, batchSize, indexGame, lastId);
+
+        // An empty batch means only deleted ids were left
+        if (indexed == 0) {
+            lastId = targetId;
+        }
+
+        if (sqlite3_prepare_v2(db, "UPDATE index_state SET last_id = ? WHERE name = ?",
+                               -1, &stmt, nullptr) != SQLITE_OK) {
+            throw runtime_error("Failed to prepare backfill update");
+        }
+        sqlite3_bind_int(stmt, 1, lastId);
+        sqlite3_bind_text(stmt, 2, indexName, -1, SQLITE_STATIC);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+
+        commitWrite();
+    } catch (const exception&) {
+        rollbackWrite();
+        throw;
+    }
+
+    return indexed;
+}
+
+// OPENING TREE
+
+void TicTacToeDB::recordOpenings(const vector<uint8_t>& moveData, const string& gameMode, int delta) {
+    struct Step {
+        int positionKey;
+        int move;
+    };
+
+    // Replay once: each of the first OPENING_DEPTH moves is folded into the
+    // canonical orientation of the position it was played from
+    char board[PositionKey::CELLS] = {' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '};
+    Step steps[OPENING_DEPTH];
+    int depth = 0;
+    for (const MoveCodec::Move& move : MoveCodec::MoveView(moveData)) {
+        if (depth < OPENING_DEPTH) {
+            int symmetry;
+            steps[depth].positionKey = PositionKey::canonical(board, &symmetry);
+            steps[depth].move = PositionKey::transformCell(move.cell, symmetry);
+            depth++;
+        }
+        board[move.cell] = move.player;
+    }
+
+    if (depth == 0) {
+        return;
+    }
+
+    // The result comes from the final board rather than `winner`, which
+    // names a user and cannot tell the sides apart in guest games
+    char winner = lineWinner(board);
+    int mode, aiLevel;
+    openingBucket(gameMode, mode, aiLevel);
+
+    sqlite3_stmt* stmt;
+    string sql = "INSERT INTO opening_stats (mode, ai_level, position_key, move, x_wins, o_wins, draws) "
+                 "VALUES (?, ?, ?, ?, ?, ?, ?) "
+                 "ON CONFLICT(mode, ai_level, position_key, move) DO UPDATE SET "
+                 "x_wins = x_wins + excluded.x_wins, "
+                 "o_wins = o_wins + excluded.o_wins, "
+                 "draws = draws + excluded.draws";
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        throw runtime_error("Failed to prepare opening update");
+    }
+
+    sqlite3_bind_int(stmt, 1, mode);
+    sqlite3_bind_int(stmt, 2, aiLevel);
+    sqlite3_bind_int(stmt, 5, winner == 'X' ? delta : 0);
+    sqlite3_bind_int(stmt, 6, winner == 'O' ? delta : 0);
+    sqlite3_bind_int(stmt, 7, winner == ' ' ? delta : 0);
+
+    for (int i = 0; i < depth; i++) {
+        sqlite3_bind_int(stmt, 3, steps[i].positionKey);
+        sqlite3_bind_int(stmt, 4, steps[i].move);
+
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            sqlite3_finalize(stmt);
+            throw runtime_error("Failed to update opening tree");
+        }
+        sqlite3_reset(stmt);
+    }
+
+    sqlite3_finalize(stmt);
+}
+
+void TicTacToeDB::forgetOpenings(const string& table, const string& condition, int id) {
+    // Takes back the counts of games about to be deleted. Only games the tree
+    // has seen count: saved after v5, or already reached by the backfill.
+    sqlite3_stmt* stmt;
+    string sql = "SELECT move_data, moves, game_mode FROM " + table + " WHERE (" + condition + ") AND "
+                 "(id > (SELECT target_id FROM index_state WHERE name = 'openings') "
+                 "OR id <= (SELECT last_id FROM index_state WHERE name = 'openings'))";
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        throw runtime_error("Failed to prepare opening cleanup");
+    }
+    sqlite3_bind_int(stmt, 1, id);
+
+    vector<pair<vector<uint8_t>, string>> games;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        vector<uint8_t> moveData;
+        readMoveColumns(stmt, 0, 1, moveData);
+        games.emplace_back(std::move(moveData), sqlite3_column_type(stmt, 2) == SQLITE_NULL ?
+                                                    "Classic" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)));
+    }
+    sqlite3_finalize(stmt);
+
+    if (games.empty()) {
+        return;
+    }
+
+    for (const auto& game : games) {
+        recordOpenings(game.first, game.second, -1);
+    }
+    executeSQL("DELETE FROM opening_stats WHERE x_wins + o_wins + draws <= 0;");
+}
+
+int TicTacToeDB::backfillOpenings(int batchSize) {
+    return backfill("openings", batchSize,
+                    [this](int, const vector<uint8_t>& moveData, const string& gameMode) {
+                        recordOpenings(moveData, gameMode, 1);
+                    });
+}
+
+vector<TicTacToeDB::OpeningMove> TicTacToeDB::queryOpenings(const char* board, const string& gameMode) {
+    vector<OpeningMove> moves;
+    int mode, aiLevel;
+    openingBucket(gameMode, mode, aiLevel);
+
+    int key = PositionKey::canonical(board);
+
+    sqlite3_stmt* stmt;
+    string sql = "SELECT move, x_wins, o_wins, draws FROM opening_stats "
+                 "WHERE mode = ? AND ai_level = ? AND position_key = ?";
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        cerr << "Failed to prepare opening query: " << sqlite3_errmsg(db) << endl;
+        return moves;
+    }
+
+    sqlite3_bind_int(stmt, 1, mode);
+    sqlite3_bind_int(stmt, 2, aiLevel);
+    sqlite3_bind_int(stmt, 3, key);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int canonicalMove = sqlite3_column_int(stmt, 0);
+        int xWins = sqlite3_column_int(stmt, 1);
+        int oWins = sqlite3_column_int(stmt, 2);
+        int draws = sqlite3_column_int(stmt, 3);
+
+        // A symmetric board has several symmetries mapping it to the same
+        // key; each one turns the stored move into an equivalent cell here
+        bool seen[PositionKey::CELLS] = {};
+        for (int s = 0; s < PositionKey::SYMMETRIES; s++) {
+            if (PositionKey::encode(board, s) != key) {
+                continue;
+            }
+            int cell = PositionKey::inverseTransformCell(canonicalMove, s);
+            if (!seen[cell]) {
+                seen[cell] = true;
+                moves.push_back({cell, xWins, oWins, draws});
+            }
+        }
+    }
+
+    sqlite3_finalize(stmt);
+
+    std::stable_sort(moves.begin(), moves.end(), [](const OpeningMove& a, const OpeningMove& b) {
+        return a.games() > b.games();
+    });
+    return moves;
+}
+
+// RATINGS
+
+void TicTacToeDB::applyElo(Rating& a, Rating& b, double score) {
+    double expected = 1.0 / (1.0 + std::pow(10.0, (b.rating - a.rating) / 400.0));
+    double change = RATING_K * (score - expected);
+    a.rating += change;
+    b.rating -= change;
+
+    a.games++;
+    b.games++;
+    if (score == 1.0) {
+        a.wins++;
+        b.losses++;
+    } else if (score == 0.0) {
+        a.losses++;
+        b.wins++;
+    } else {
+        a.draws++;
+        b.draws++;
+    }
+}
+
+TicTacToeDB::Rating TicTacToeDB::loadRating(int playerId, const string& table) {
+    Rating rating;
+    sqlite3_stmt* stmt;
+    string sql = "SELECT rating, games, wins, losses, draws FROM " + table + " WHERE player_id = ?";
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        throw runtime_error("Failed to prepare rating query");
+    }
+    sqlite3_bind_int(stmt, 1, playerId);
+
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        rating.rating = sqlite3_column_double(stmt, 0);
+        rating.games = sqlite3_column_int(stmt, 1);
+        rating.wins = sqlite3_column_int(stmt, 2);
+        rating.losses = sqlite3_column_int(stmt, 3);
+        rating.draws = sqlite3_column_int(stmt, 4);
+    }
+
+    sqlite3_finalize(stmt);
+    return rating;
+}
+
+void TicTacToeDB::storeRating(int playerId, const Rating& rating, const string& table) {
+    sqlite3_stmt* stmt;
+    string sql = "INSERT OR REPLACE INTO " + table + " (player_id, rating, games, wins, losses, draws) "
+                 "VALUES (?, ?, ?, ?, ?, ?)";
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        throw runtime_error("Failed to prepare rating update");
+    }
+
+    sqlite3_bind_int(stmt, 1, playerId);
+    sqlite3_bind_double(stmt, 2, rating.rating);
+    sqlite3_bind_int(stmt, 3, rating.games);
+    sqlite3_bind_int(stmt, 4, rating.wins);
+    sqlite3_bind_int(stmt, 5, rating.losses);
+    sqlite3_bind_int(stmt, 6, rating.draws);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        sqlite3_finalize(stmt);
+        throw runtime_error("Failed to store rating");
+    }
+    sqlite3_finalize(stmt);
+}
+
+void TicTacToeDB::updateRatings(int player1Id, int player2Id, int winner, const string& gameMode) {
+    int first, second;
+    if (!ratedPlayers(player1Id, player2Id, gameMode, first, second)) {
+        return;
+    }
+
+    Rating a = loadRating(first);
+    Rating b = loadRating(second);
+    applyElo(a, b, scoreFor(player1Id, winner));
+    storeRating(first, a);
+    storeRating(second, b);
+}
+
+int TicTacToeDB::replayRatings() {
+    sqlite3_stmt* stmt;
+
+    // A single forward cursor in play order; only the players' ratings are
+    // held in memory, never the games (SQLite spills the sort to disk)
+    if (sqlite3_prepare_v2(db, "SELECT player1_id, player2_id, winner, game_mode, timestamp, id FROM games "
+                               "UNION ALL "
+                               "SELECT player1_id, player2_id, winner, game_mode, timestamp, id FROM archive.games "
+                               "ORDER BY timestamp, id",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        throw runtime_error("Failed to prepare rating replay");
+    }
+
+    unordered_map<int, Rating> ratings;
+    int games = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int player1Id = sqlite3_column_int(stmt, 0);
+        int player2Id = sqlite3_column_type(stmt, 1) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 1);
+        int winner = sqlite3_column_type(stmt, 2) == SQLITE_NULL ? 0 : sqlite3_column_int(stmt, 2);
+        string gameMode = sqlite3_column_type(stmt, 3) == SQLITE_NULL ?
+                              "Classic" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+
+        int first, second;
+        if (ratedPlayers(player1Id, player2Id, gameMode, first, second)) {
+            applyElo(ratings[first], ratings[second], scoreFor(player1Id, winner));
+            games++;
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    for (const auto& entry : ratings) {
+        storeRating(entry.first, entry.second);
+    }
+    return games;
 }
 
-TicTacToeDB::~TicTacToeDB() {
-    sqlite3_close(db);
+int TicTacToeDB::recomputeRatings() {
+    int games = 0;
+    beginWrite();
+    try {
+        executeSQL("DELETE FROM ratings;");
+        games = replayRatings();
+        commitWrite();
+    } catch (const exception&) {
+        rollbackWrite();
+        throw;
+    }
+    return games;
 }
 
-// LOGIN FUNCTIONALITY
+void TicTacToeDB::queueRatingRebuild() {
+    // Starting over drops whatever an earlier rebuild had replayed
+    executeSQL("DELETE FROM rating_shadow;");
+    executeSQL("INSERT OR REPLACE INTO rating_rebuild (id, after_timestamp, after_id) VALUES (1, '', 0);");
+}
 
-bool TicTacToeDB::createUser(const string& username, const string& password) {
-    // Input validation
-    if (username.empty() || password.empty()) {
-        cerr << "Username and password cannot be empty\n";
-        return false;
+int TicTacToeDB::resumeRatingRebuild(int batchSize) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT EXISTS (SELECT 1 FROM rating_rebuild)", -1, &stmt, nullptr) != SQLITE_OK) {
+        return 0;
     }
-
-    if (password.length() < 4) {
-        cerr << "Password must be at least 4 characters long\n";
-        return false;
+    bool queued = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) != 0;
+    sqlite3_finalize(stmt);
+    if (!queued) {
+        return 0;
     }
 
-    // Check if username already exists
-    if (userExists(username)) {
-        cerr << "Username already exists: " << username << "\n";
-        return false;
+    struct PlayedGame {
+        string timestamp;
+        int id;
+        int player1Id;
+        int player2Id;
+        int winner;
+        string gameMode;
+
+        bool operator<(const PlayedGame& other) const {
+            return timestamp != other.timestamp ? timestamp < other.timestamp : id < other.id;
+        }
+    };
+
+    beginWrite();
+    try {
+        string afterTimestamp;
+        int afterId = 0;
+        if (sqlite3_prepare_v2(db, "SELECT after_timestamp, after_id FROM rating_rebuild", -1, &stmt,
+                               nullptr) != SQLITE_OK) {
+            throw runtime_error("Failed to prepare rating rebuild");
+        }
+        queued = sqlite3_step(stmt) == SQLITE_ROW;
+        if (queued) {
+            afterTimestamp = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+            afterId = sqlite3_column_int(stmt, 1);
+        }
+        sqlite3_finalize(stmt);
+        if (!queued) {
+            commitWrite();
+            return 0;
+        }
+
+        // The next games in play order from each tier, each a range read of
+        // its timestamp index; merged, the first batchSize are this batch
+        vector<PlayedGame> games;
+        bool lastBatch = true;
+        for (const char* table : {"main.games", "archive.games"}) {
+            string sql = string("SELECT timestamp, id, player1_id, player2_id, winner, game_mode FROM ") + table +
+                         " WHERE (timestamp, id) > (?1, ?2) ORDER BY timestamp, id LIMIT ?3";
+            if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+                throw runtime_error("Failed to prepare rating rebuild batch");
+            }
+            sqlite3_bind_text(stmt, 1, afterTimestamp.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int(stmt, 2, afterId);
+            sqlite3_bind_int(stmt, 3, batchSize);
+            int rows = 0;
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                rows++;
+                PlayedGame game;
+                game.timestamp = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+                game.id = sqlite3_column_int(stmt, 1);
+                game.player1Id = sqlite3_column_int(stmt, 2);
+                game.player2Id = sqlite3_column_type(stmt, 3) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 3);
+                game.winner = sqlite3_column_type(stmt, 4) == SQLITE_NULL ? 0 : sqlite3_column_int(stmt, 4);
+                game.gameMode = sqlite3_column_type(stmt, 5) == SQLITE_NULL ?
+                                    "Classic" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+                games.push_back(game);
+            }
+            sqlite3_finalize(stmt);
+            if (rows == batchSize) {
+                lastBatch = false;
+            }
+        }
+        std::sort(games.begin(), games.end());
+        if (static_cast<int>(games.size()) > batchSize) {
+            games.resize(batchSize);
+            lastBatch = false;
+        }
+
+        unordered_map<int, Rating> ratings;
+        for (const PlayedGame& game : games) {
+            int first, second;
+            if (!ratedPlayers(game.player1Id, game.player2Id, game.gameMode, first, second)) {
+                continue;
+            }
+            for (int player : {first, second}) {
+                if (ratings.find(player) == ratings.end()) {
+                    ratings[player] = loadRating(player, "rating_shadow");
+                }
+            }
+            applyElo(ratings[first], ratings[second], scoreFor(game.player1Id, game.winner));
+        }
+        for (const auto& entry : ratings) {
+            storeRating(entry.first, entry.second, "rating_shadow");
+        }
+
+        if (lastBatch) {
+            // Caught up; saves queue behind this turn, so none is missed
+            executeSQL("DELETE FROM ratings;");
+            executeSQL("INSERT INTO ratings (player_id, rating, games, wins, losses, draws) "
+                       "SELECT player_id, rating, games, wins, losses, draws FROM rating_shadow;");
+            executeSQL("DELETE FROM rating_shadow;");
+            executeSQL("DELETE FROM rating_rebuild;");
+        } else {
+            if (sqlite3_prepare_v2(db, "UPDATE rating_rebuild SET after_timestamp = ?, after_id = ?", -1, &stmt,
+                                   nullptr) != SQLITE_OK) {
+                throw runtime_error("Failed to prepare rating rebuild cursor");
+            }
+            sqlite3_bind_text(stmt, 1, games.back().timestamp.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int(stmt, 2, games.back().id);
+            bool advanced = sqlite3_step(stmt) == SQLITE_DONE;
+            sqlite3_finalize(stmt);
+            if (!advanced) {
+                throw runtime_error("Failed to advance rating rebuild");
+            }
+        }
+        commitWrite();
+    } catch (const exception&) {
+        rollbackWrite();
+        throw;
     }
+    return 1;
+}
 
+vector<TicTacToeDB::RatingEntry> TicTacToeDB::getLeaderboard(int limit) {
+    vector<RatingEntry> entries;
     sqlite3_stmt* stmt;
-    string insertSql = "INSERT INTO users (username, password_hash) VALUES (?, ?)";
 
-    if (sqlite3_prepare_v2(db, insertSql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        cerr << "Failed to prepare insert statement\n";
-        return false;
+    string sql = "SELECT r.player_id, u.username, r.rating, r.games, r.wins, r.losses, r.draws "
+                 "FROM ratings r LEFT JOIN users u ON u.id = r.player_id "
+                 "ORDER BY r.rating DESC, r.player_id LIMIT ?";
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        cerr << "Failed to prepare leaderboard query: " << sqlite3_errmsg(db) << endl;
+        return entries;
     }
 
-    string hashed = sha256Hash(password);
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, hashed.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 1, limit);
 
-    bool result = sqlite3_step(stmt) == SQLITE_DONE;
-    if (!result) {
-        cerr << "Error creating user '" << username << "'\n";
+    static const char* AI_NAMES[] = {"AI", "AI Easy", "AI Medium", "AI Hard"};
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        RatingEntry entry;
+        entry.playerId = sqlite3_column_int(stmt, 0);
+        if (entry.playerId < 0) {
+            int level = -entry.playerId;
+            entry.name = AI_NAMES[level <= 3 ? level : 0];
+        } else {
+            entry.name = sqlite3_column_type(stmt, 1) == SQLITE_NULL ?
+                             "Unknown" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        }
+        entry.rating = sqlite3_column_double(stmt, 2);
+        entry.games = sqlite3_column_int(stmt, 3);
+        entry.wins = sqlite3_column_int(stmt, 4);
+        entry.losses = sqlite3_column_int(stmt, 5);
+        entry.draws = sqlite3_column_int(stmt, 6);
+        entries.push_back(entry);
     }
 
     sqlite3_finalize(stmt);
-    return result;
+    return entries;
 }
 
-bool TicTacToeDB::validateUser(const string& username, const string& password) {
-    if (username.empty() || password.empty()) {
-        return false;
+// ROLLUPS
+
+void TicTacToeDB::adjustRollups(const string& table, const string& condition, int id, int sign) {
+    // One upsert per bucket touched. Games keep their buckets when they are
+    // archived, so only saves, imports and deletes come through here.
+    // Timestamps that do not parse fall out of every bucket both ways.
+    string s = to_string(sign);
+    executeWithId("INSERT INTO game_rollups "
+                  "(grain, bucket, mode, ai_level, games, total_moves, player1_wins, player2_wins, ai_wins, draws) "
+                  "SELECT grain, bucket, mode, ai_level, " + s + " * COUNT(*), "
+                  + s + " * SUM(IFNULL(game_duration, 0)), "
+                  + s + " * SUM(CASE WHEN winner = player1_id THEN 1 ELSE 0 END), "
+                  + s + " * SUM(CASE WHEN winner != player1_id AND winner > 0 THEN 1 ELSE 0 END), "
+                  + s + " * SUM(CASE WHEN winner = -1 THEN 1 ELSE 0 END), "
+                  + s + " * SUM(CASE WHEN winner IS NULL OR winner = 0 THEN 1 ELSE 0 END) "
+                  "FROM (SELECT grains.grain, strftime(grains.format, timestamp) AS bucket, "
+                  + MODE_BUCKET_SQL + " AS mode, " + AI_LEVEL_SQL + " AS ai_level, "
+                  "player1_id, winner, game_duration "
+                  "FROM " + table + " CROSS JOIN ("
+                  "SELECT " + to_string(HOURLY) + " AS grain, '%Y-%m-%d %H:00' AS format "
+                  "UNION ALL SELECT " + to_string(DAILY) + ", '%Y-%m-%d' "
+                  "UNION ALL SELECT " + to_string(MONTHLY) + ", '%Y-%m') grains "
+                  "WHERE (" + condition + ")) "
+                  "WHERE bucket IS NOT NULL "
+                  "GROUP BY grain, bucket, mode, ai_level "
+                  "ON CONFLICT(grain, bucket, mode, ai_level) DO UPDATE SET "
+                  "games = games + excluded.games, "
+                  "total_moves = total_moves + excluded.total_moves, "
+                  "player1_wins = player1_wins + excluded.player1_wins, "
+                  "player2_wins = player2_wins + excluded.player2_wins, "
+                  "ai_wins = ai_wins + excluded.ai_wins, "
+                  "draws = draws + excluded.draws",
+                  id);
+
+    if (sign < 0) {
+        executeSQL("DELETE FROM game_rollups WHERE games <= 0;");
+    }
+}
+
+void TicTacToeDB::countAllRollups() {
+    // Archive copies whose hot row still exists are counted through the hot row
+    adjustRollups("games", "1", 0, 1);
+    adjustRollups("archive.games", "id NOT IN (SELECT id FROM main.games)", 0, 1);
+}
+
+void TicTacToeDB::rebuildRollups() {
+    beginWrite();
+    try {
+        executeSQL("DELETE FROM game_rollups;");
+        countAllRollups();
+        commitWrite();
+    } catch (const exception&) {
+        rollbackWrite();
+        throw;
     }
+}
 
+vector<TicTacToeDB::RollupRow> TicTacToeDB::queryRollups(const RollupQuery& query) {
+    vector<RollupRow> rows;
     sqlite3_stmt* stmt;
-    string sql = "SELECT password_hash FROM users WHERE username = ?";
+
+    // A range read of the primary key; rows come out in key order
+    string sql = "SELECT bucket, mode, ai_level, games, total_moves, player1_wins, player2_wins, ai_wins, draws "
+                 "FROM game_rollups WHERE grain = ?1";
+    if (!query.from.empty()) {
+        sql += " AND bucket >= ?2";
+    }
+    if (!query.to.empty()) {
+        sql += " AND bucket <= ?3";
+    }
+    if (!query.gameMode.empty()) {
+        sql += " AND mode = ?4 AND ai_level = ?5";
+    }
+    sql += " ORDER BY grain, bucket, mode, ai_level";
 
     if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        return false;
+        cerr << "Failed to prepare rollup query: " << sqlite3_errmsg(db) << endl;
+        return rows;
     }
 
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+    int mode, aiLevel;
+    openingBucket(query.gameMode, mode, aiLevel);
+    sqlite3_bind_int(stmt, 1, query.grain);
+    sqlite3_bind_text(stmt, 2, query.from.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, query.to.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 4, mode);
+    sqlite3_bind_int(stmt, 5, aiLevel);
 
-    bool isValid = false;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        string storedHash = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        isValid = (sha256Hash(password) == storedHash);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        RollupRow row;
+        row.bucket = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        row.gameMode = bucketName(sqlite3_column_int(stmt, 1), sqlite3_column_int(stmt, 2));
+        row.games = sqlite3_column_int(stmt, 3);
+        row.totalMoves = sqlite3_column_int(stmt, 4);
+        row.player1Wins = sqlite3_column_int(stmt, 5);
+        row.player2Wins = sqlite3_column_int(stmt, 6);
+        row.aiWins = sqlite3_column_int(stmt, 7);
+        row.draws = sqlite3_column_int(stmt, 8);
+        rows.push_back(row);
     }
 
     sqlite3_finalize(stmt);
-    return isValid;
+    return rows;
 }
 
-bool TicTacToeDB::userExists(const string& username) {
-    sqlite3_stmt* stmt;
-    string checkSql = "SELECT id FROM users WHERE username = ?";
+int TicTacToeDB::exportRollupsCsv(const RollupQuery& query, ostream& out) {
+    vector<RollupRow> rows = queryRollups(query);
+
+    out << "bucket,game_mode,games,average_moves,player1_wins,player2_wins,ai_wins,draws,ai_win_rate\n";
+    for (const RollupRow& row : rows) {
+        char average[32];
+        char aiWinRate[32] = "";
+        snprintf(average, sizeof(average), "%.2f", row.averageMoves());
+        // Left empty for games without the AI
+        if (row.gameMode.compare(0, 2, "AI") == 0) {
+            snprintf(aiWinRate, sizeof(aiWinRate), "%.4f", row.aiWinRate());
+        }
 
-    if (sqlite3_prepare_v2(db, checkSql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        return false;
+        out << row.bucket << ',' << row.gameMode << ',' << row.games << ',' << average << ','
+            << row.player1Wins << ',' << row.player2Wins << ',' << row.aiWins << ',' << row.draws << ','
+            << aiWinRate << '\n';
     }
 
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
-    bool exists = sqlite3_step(stmt) == SQLITE_ROW;
-    sqlite3_finalize(stmt);
+    out.flush();
+    if (!out) {
+        throw runtime_error("Failed to write rollups");
+    }
+    return static_cast<int>(rows.size());
+}
 
-    return exists;
+// ARCHIVE FILES
+
+TicTacToeDB::ArchiveStats TicTacToeDB::exportArchive(ostream& out) {
+    ArchiveStats stats;
+    sqlite3_stmt* stmt = nullptr;
+
+    // One read transaction, so users and games come from the same snapshot
+    executeSQL("BEGIN;");
+    try {
+        out << GameArchive::HEADER << '\n';
+
+        if (sqlite3_prepare_v2(db, "SELECT username, password_hash, created_at FROM users ORDER BY id",
+                               -1, &stmt, nullptr) != SQLITE_OK) {
+            throw runtime_error("Failed to prepare user export");
+        }
+
+        GameArchive::UserLine user;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            user.username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+            user.passwordHash = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            user.createdAt = sqlite3_column_type(stmt, 2) == SQLITE_NULL ?
+                                 "" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+            out << GameArchive::formatUser(user) << '\n';
+            stats.users++;
+        }
+        sqlite3_finalize(stmt);
+        stmt = nullptr;
+
+        // Both tiers, so an export is complete whatever has been archived
+        string sql = "SELECT g.timestamp, u1.username, u2.username, g.player1_id, g.player2_id, g.winner, "
+                     "g.game_mode, g.move_data, g.moves "
+                     "FROM (SELECT " + string(GAME_COLUMNS) + " FROM archive.games "
+                     "UNION ALL SELECT " + string(GAME_COLUMNS) + " FROM games) g "
+                     "LEFT JOIN users u1 ON g.player1_id = u1.id "
+                     "LEFT JOIN users u2 ON g.player2_id = u2.id "
+                     "ORDER BY g.id";
+
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            throw runtime_error("Failed to prepare game export");
+        }
+
+        GameArchive::GameLine game;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            if (sqlite3_column_type(stmt, 1) == SQLITE_NULL) {
+                stats.rejected++;
+                continue;
+            }
+
+            int player1Id = sqlite3_column_int(stmt, 3);
+            int player2Id = sqlite3_column_type(stmt, 4) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 4);
+            int winner = sqlite3_column_type(stmt, 5) == SQLITE_NULL ? 0 : sqlite3_column_int(stmt, 5);
+
+            game.timestamp = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+            game.player1 = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            game.player2 = sqlite3_column_type(stmt, 2) == SQLITE_NULL ?
+                               "" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+            game.winner = winner == -1 ? 'A' :
+                          winner != 0 && winner == player1Id ? '1' :
+                          winner != 0 && winner == player2Id ? '2' : '-';
+            game.gameMode = sqlite3_column_type(stmt, 6) == SQLITE_NULL ?
+                                "Classic" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
+            readMoveColumns(stmt, 7, 8, game.moveData);
+            game.plyCount = MoveCodec::MoveView(game.moveData).plyCount();
+
+            out << GameArchive::formatGame(game) << '\n';
+            stats.games++;
+        }
+        sqlite3_finalize(stmt);
+        stmt = nullptr;
+
+        executeSQL("COMMIT;");
+    } catch (const exception&) {
+        sqlite3_finalize(stmt);
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        throw;
+    }
+
+    out.flush();
+    if (!out) {
+        throw runtime_error("Failed to write archive");
+    }
+    return stats;
 }
 
-int TicTacToeDB::getUserId(const string& username) {
-    sqlite3_stmt* stmt;
-    string sql = "SELECT id FROM users WHERE username = ?";
+TicTacToeDB::ArchiveStats TicTacToeDB::importArchive(istream& in, int batchSize) {
+    ArchiveStats stats;
+    string line;
 
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        return -1;
+    if (!getline(in, line) || line.compare(0, strlen(GameArchive::HEADER), GameArchive::HEADER) != 0) {
+        throw runtime_error("Not a game archive");
     }
 
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+    enum { INSERT_USER, FIND_USER, FIND_GAME, INSERT_GAME, STATEMENT_COUNT };
+    const char* statementSql[STATEMENT_COUNT] = {
+        "INSERT OR IGNORE INTO users (username, password_hash, created_at) "
+        "VALUES (?1, ?2, IFNULL(NULLIF(?3, ''), CURRENT_TIMESTAMP))",
+        "SELECT id FROM users WHERE username = ?",
+        // Walks the player1 index of each tier; an archive imported twice adds nothing
+        "SELECT 1 FROM games WHERE player1_id = ?1 AND timestamp = ?2 AND move_data = ?3 AND game_mode = ?4 "
+        "UNION ALL "
+        "SELECT 1 FROM archive.games WHERE player1_id = ?1 AND timestamp = ?2 AND move_data = ?3 AND game_mode = ?4 "
+        "LIMIT 1",
+        "INSERT INTO games (player1_id, player2_id, winner, move_data, game_mode, game_duration, timestamp) "
+        "VALUES (?1, ?2, ?3, ?4, ?5, ?6, IFNULL(NULLIF(?7, ''), CURRENT_TIMESTAMP))"
+    };
+    sqlite3_stmt* statements[STATEMENT_COUNT] = {};
+
+    auto finalizeStatements = [&statements]() {
+        for (sqlite3_stmt*& stmt : statements) {
+            sqlite3_finalize(stmt);
+            stmt = nullptr;
+        }
+    };
 
-    int userId = -1;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        userId = sqlite3_column_int(stmt, 0);
+    for (int i = 0; i < STATEMENT_COUNT; i++) {
+        if (sqlite3_prepare_v2(db, statementSql[i], -1, &statements[i], nullptr) != SQLITE_OK) {
+            cerr << "Failed to prepare import statement: " << sqlite3_errmsg(db) << endl;
+            finalizeStatements();
+            throw runtime_error("Failed to prepare import");
+        }
     }
 
-    sqlite3_finalize(stmt);
-    return userId;
+    // Usernames seen so far; archives name players, the tables use ids
+    unordered_map<string, int> userIds;
+    auto resolveUser = [&](const string& username) {
+        auto cached = userIds.find(username);
+        if (cached != userIds.end()) {
+            return cached->second;
+        }
+
+        sqlite3_stmt* stmt = statements[FIND_USER];
+        sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+        int userId = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : -1;
+        sqlite3_reset(stmt);
+
+        if (userId != -1) {
+            userIds[username] = userId;
+        }
+        return userId;
+    };
+
+    // The write lock is held for a whole batch, so every id above the
+    // largest one at its start belongs to the batch
+    int batchStart = 0;
+    int batchGames = 0;
+    auto beginBatch = [&]() {
+        beginWrite();
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, "SELECT IFNULL(MAX(id), 0) FROM games", -1, &stmt, nullptr) != SQLITE_OK) {
+            throw runtime_error("Failed to prepare import batch");
+        }
+        batchStart = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : 0;
+        sqlite3_finalize(stmt);
+        batchGames = 0;
+    };
+    auto commitBatch = [&]() {
+        // Derived tables get one pass over the batch once its rows are in
+        int lastId;
+        visitGames(batchStart, INT_MAX, -1, [this](int gameId, const vector<uint8_t>& moveData, const string& gameMode) {
+            indexPositions(gameId, moveData);
+            recordOpenings(moveData, gameMode, 1);
+        }, lastId);
+        adjustRollups("games", "id > ?1", batchStart, 1);
+        commitWrite();
+    };
+
+    GameArchive::UserLine user;
+    GameArchive::GameLine game;
+    try {
+        beginBatch();
+
+        while (getline(in, line)) {
+            switch (GameArchive::parseLine(line, user, game)) {
+            case GameArchive::USER_LINE: {
+                // A username that already exists keeps its local password
+                sqlite3_stmt* stmt = statements[INSERT_USER];
+                sqlite3_bind_text(stmt, 1, user.username.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt, 2, user.passwordHash.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt, 3, user.createdAt.c_str(), -1, SQLITE_TRANSIENT);
+                if (sqlite3_step(stmt) != SQLITE_DONE) {
+                    sqlite3_reset(stmt);
+                    throw runtime_error("Failed to import user");
+                }
+                if (sqlite3_changes(db) > 0) {
+                    stats.users++;
+                }
+                sqlite3_reset(stmt);
+                break;
+            }
+
+            case GameArchive::GAME_LINE: {
+                int player1Id = resolveUser(game.player1);
+                int player2Id = game.player2.empty() ? -1 : resolveUser(game.player2);
+                if (player1Id == -1 || (!game.player2.empty() && player2Id == -1) ||
+                    (game.winner == '2' && player2Id == -1)) {
+                    stats.rejected++;
+                    break;
+                }
+
+                sqlite3_stmt* stmt = statements[FIND_GAME];
+                sqlite3_bind_int(stmt, 1, player1Id);
+                sqlite3_bind_text(stmt, 2, game.timestamp.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_blob(stmt, 3, game.moveData.data(), static_cast<int>(game.moveData.size()), SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt, 4, game.gameMode.c_str(), -1, SQLITE_TRANSIENT);
+                bool duplicate = sqlite3_step(stmt) == SQLITE_ROW;
+                sqlite3_reset(stmt);
+                if (duplicate) {
+                    stats.duplicates++;
+                    break;
+                }
+
+                int winner = game.winner == '1' ? player1Id :
+                             game.winner == '2' ? player2Id :
+                             game.winner == 'A' ? -1 : 0;
+
+                stmt = statements[INSERT_GAME];
+                sqlite3_bind_int(stmt, 1, player1Id);
+                player2Id == -1 ? sqlite3_bind_null(stmt, 2) : sqlite3_bind_int(stmt, 2, player2Id);
+                winner == 0 ? sqlite3_bind_null(stmt, 3) : sqlite3_bind_int(stmt, 3, winner);
+                sqlite3_bind_blob(stmt, 4, game.moveData.data(), static_cast<int>(game.moveData.size()), SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt, 5, game.gameMode.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_int(stmt, 6, game.plyCount);
+                sqlite3_bind_text(stmt, 7, game.timestamp.c_str(), -1, SQLITE_TRANSIENT);
+                if (sqlite3_step(stmt) != SQLITE_DONE) {
+                    sqlite3_reset(stmt);
+                    throw runtime_error("Failed to import game");
+                }
+                sqlite3_reset(stmt);
+
+                stats.games++;
+                if (++batchGames >= batchSize) {
+                    commitBatch();
+                    beginBatch();
+                }
+                break;
+            }
+
+            case GameArchive::INVALID_LINE:
+                stats.rejected++;
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        commitBatch();
+    } catch (const exception&) {
+        rollbackWrite();
+        finalizeStatements();
+        throw;
+    }
+
+    finalizeStatements();
+
+    // Imported games are usually older than local ones, so ratings are
+    // replayed in play order rather than patched
+    if (stats.games > 0) {
+        recomputeRatings();
+    }
+    return stats;
 }
 
-string TicTacToeDB::getUsernameById(int userId) {
-    sqlite3_stmt* stmt;
-    string sql = "SELECT username FROM users WHERE id = ?";
+// COLD STORAGE
 
+void TicTacToeDB::executeWithId(const string& sql, int id) {
+    sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        return "Unknown";
+        cerr << "SQL error: " << sqlite3_errmsg(db) << endl;
+        throw runtime_error("Database error");
     }
 
-    sqlite3_bind_int(stmt, 1, userId);
+    sqlite3_bind_int(stmt, 1, id);
+    int result = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
 
-    string username = "Unknown";
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    if (result != SQLITE_DONE) {
+        throw runtime_error("Database error");
     }
+}
 
-    sqlite3_finalize(stmt);
-    return username;
+void TicTacToeDB::adjustArchiveSummary(const string& table, const string& condition, int id, int sign) {
+    // Each game counts once for player 1 and once for a distinct player 2,
+    // the same way getUserStats counts hot games
+    string s = to_string(sign);
+    executeWithId("INSERT INTO archive_summary (user_id, games, wins, losses, draws) "
+                  "SELECT player, " + s + " * COUNT(*), "
+                  + s + " * SUM(CASE WHEN winner = player THEN 1 ELSE 0 END), "
+                  + s + " * SUM(CASE WHEN winner != player AND winner IS NOT NULL AND winner != 0 THEN 1 ELSE 0 END), "
+                  + s + " * SUM(CASE WHEN winner IS NULL OR winner = 0 THEN 1 ELSE 0 END) "
+                  "FROM (SELECT player1_id AS player, winner FROM " + table + " WHERE (" + condition + ") "
+                  "UNION ALL "
+                  "SELECT player2_id, winner FROM " + table + " WHERE (" + condition + ") "
+                  "AND player2_id IS NOT NULL AND player2_id != player1_id) "
+                  "GROUP BY player "
+                  "ON CONFLICT(user_id) DO UPDATE SET "
+                  "games = games + excluded.games, "
+                  "wins = wins + excluded.wins, "
+                  "losses = losses + excluded.losses, "
+                  "draws = draws + excluded.draws",
+                  id);
 }
 
-bool TicTacToeDB::deleteUser(const string& username) {
+void TicTacToeDB::removeArchivedGames(const string& condition, int id) {
+    // Archived games are outside the reach of games' foreign keys, so
+    // everything derived from them is cleaned up by hand. Copies whose hot
+    // row still exists (an archiving run in progress or interrupted) were
+    // never counted as archived and are only deleted.
+    const string archivedOnly = "(" + condition + ") AND id NOT IN (SELECT id FROM main.games)";
+    forgetOpenings("archive.games", archivedOnly, id);
+    adjustArchiveSummary("archive.games", archivedOnly, id, -1);
+    adjustRollups("archive.games", archivedOnly, id, -1);
+    executeWithId("DELETE FROM archive.positions WHERE game_id IN "
+                  "(SELECT id FROM archive.games WHERE (" + condition + "))", id);
+    executeWithId("DELETE FROM archive.games WHERE (" + condition + ")", id);
+    executeSQL("DELETE FROM archive_summary WHERE games <= 0;");
+}
+
+string TicTacToeDB::newestArchivedTimestamp() {
+    string newest;
     sqlite3_stmt* stmt;
-    string sql = "DELETE FROM users WHERE username = ?";
 
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        cerr << "Failed to prepare delete statement\n";
-        return false;
+    // Read off the end of idx_archive_timestamp
+    if (sqlite3_prepare_v2(db, "SELECT MAX(timestamp) FROM archive.games", -1, &stmt, nullptr) != SQLITE_OK) {
+        return newest;
     }
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+        newest = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    return newest;
+}
 
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+int TicTacToeDB::archiveGamesOlderThan(int days, int batchSize) {
+    sqlite3_stmt* stmt;
 
-    bool success = sqlite3_step(stmt) == SQLITE_DONE;
+    // Games the backfills have not reached would never be indexed once they
+    // leave the hot table, so archiving waits for them
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM index_state WHERE last_id < target_id",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        return 0;
+    }
+    bool indexing = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) > 0;
+    sqlite3_finalize(stmt);
 
-    if (!success) {
-        cerr << "Failed to delete user or user not found\n";
+    if (indexing) {
+        cerr << "Archiving waits for the index backfill to finish\n";
+        return 0;
     }
 
-    sqlite3_finalize(stmt);
-    return success;
-}
+    // A batch left over from an interrupted run goes first
+    finishPendingArchive();
+
+    // The batch is recorded before anything moves; finishPendingArchive()
+    // then carries it out
+    int selected = 0;
+    beginWrite();
+    try {
+        if (sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO main.archive_pending (id) "
+                                   "SELECT id FROM main.games WHERE timestamp < datetime('now', ?) ORDER BY id LIMIT ?",
+                               -1, &stmt, nullptr) != SQLITE_OK) {
+            throw runtime_error("Failed to prepare archive batch");
+        }
+        string age = "-" + to_string(days) + " days";
+        sqlite3_bind_text(stmt, 1, age.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 2, batchSize);
+        bool recorded = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_finalize(stmt);
+        if (!recorded) {
+            throw runtime_error("Failed to select games to archive");
+        }
+        selected = sqlite3_changes(db);
+        commitWrite();
+    } catch (const exception&) {
+        rollbackWrite();
+        throw;
+    }
 
-// HISTORY FUNCTIONALITY
+    return selected == 0 ? 0 : finishPendingArchive();
+}
 
-void TicTacToeDB::saveGame(int player1Id, int player2Id, int winner, const vector<string>& moves, const string& gameMode) {
+void TicTacToeDB::saveAbandonedGame(int player1Id, int player2Id, const vector<uint8_t>& moveData, int plyCount,
+                                    const string& gameMode, const string& lastMoveAt) {
     sqlite3_stmt* stmt;
-    string sql = "INSERT INTO games (player1_id, player2_id, winner, moves, game_mode, game_duration) VALUES (?, ?, ?, ?, ?, ?)";
+    string sql = "INSERT INTO abandoned_games (player1_id, player2_id, move_data, game_mode, ply_count, last_move_at) "
+                 "VALUES (?, ?, ?, ?, ?, ?)";
 
     if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
         throw runtime_error("Failed to prepare statement");
     }
 
-    // Convert moves vector to string with comma separator
-    string movesStr;
-    for (size_t i = 0; i < moves.size(); i++) {
-        if (i > 0) movesStr += ",";
-        movesStr += moves[i];
-    }
-
     sqlite3_bind_int(stmt, 1, player1Id);
     player2Id == -1 ? sqlite3_bind_null(stmt, 2) : sqlite3_bind_int(stmt, 2, player2Id);
-    winner == 0 ? sqlite3_bind_null(stmt, 3) : sqlite3_bind_int(stmt, 3, winner);
-    sqlite3_bind_text(stmt, 4, movesStr.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 5, gameMode.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 6, static_cast<int>(moves.size())); // Game duration as number of moves
+    sqlite3_bind_blob(stmt, 3, moveData.data(), static_cast<int>(moveData.size()), SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 4, gameMode.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 5, plyCount);
+    lastMoveAt.empty() ? sqlite3_bind_null(stmt, 6) : sqlite3_bind_text(stmt, 6, lastMoveAt.c_str(), -1, SQLITE_TRANSIENT);
 
     if (sqlite3_step(stmt) != SQLITE_DONE) {
         sqlite3_finalize(stmt);
-        throw runtime_error("Failed to save game");
+        throw runtime_error("Failed to save abandoned game");
     }
 
     sqlite3_finalize(stmt);
 }
 
-vector<TicTacToeDB::GameRecord> TicTacToeDB::getGameHistory(int userId) {
-    vector<GameRecord> history;
-    sqlite3_stmt* stmt;
-    string sql = "SELECT g.id, g.player1_id, g.player2_id, g.winner, g.moves, g.timestamp, g.game_mode, "
-                 "u1.username as player1_name, u2.username as player2_name "
-                 "FROM games g "
-                 "LEFT JOIN users u1 ON g.player1_id = u1.id "
-                 "LEFT JOIN users u2 ON g.player2_id = u2.id "
-                 "WHERE g.player1_id = ? OR g.player2_id = ? "
-                 "ORDER BY g.timestamp DESC LIMIT 50";
+TicTacToeDB::GameRecord TicTacToeDB::readGameRecord(sqlite3_stmt* stmt) {
+    // Column order: id, player1_id, player2_id, winner, move_data, timestamp,
+    // game_mode, player1_name, player2_name, moves
+    GameRecord record;
+    record.id = sqlite3_column_int(stmt, 0);
+    record.player1Id = sqlite3_column_int(stmt, 1);
+    record.player2Id = sqlite3_column_type(stmt, 2) == SQLITE_NULL ?
+                           -1 : sqlite3_column_int(stmt, 2);
+    record.winner = sqlite3_column_type(stmt, 3) == SQLITE_NULL ?
+                        0 : sqlite3_column_int(stmt, 3);
+    readMoveColumns(stmt, 4, 9, record.moveData);
+    record.timestamp = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+    record.gameMode = sqlite3_column_type(stmt, 6) == SQLITE_NULL ?
+                          "Classic" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
+    record.player1Name = sqlite3_column_type(stmt, 7) == SQLITE_NULL ?
+                             "Unknown" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
+    record.player2Name = sqlite3_column_type(stmt, 8) == SQLITE_NULL ?
+                             "AI" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 8));
+
+    // Joined names warm the directory so callers never look them up again
+    UserDirectory* directory = users.get();
+    if (sqlite3_column_type(stmt, 7) != SQLITE_NULL) {
+        directory->remember(record.player1Id, record.player1Name);
+    }
+    if (sqlite3_column_type(stmt, 8) != SQLITE_NULL) {
+        directory->remember(record.player2Id, record.player2Name);
+    }
+    return record;
+}
+
+string TicTacToeDB::historySql(const HistoryQuery& query, bool includeArchive) {
+    // Filters shared by every branch; only the ones in use are emitted so
+    // the planner can walk the (player, timestamp, id) indexes directly
+    string filters;
+    if (!query.gameMode.empty()) {
+        filters += " AND game_mode = ?2";
+    }
+    switch (query.result) {
+    case WINS:
+        filters += " AND winner = ?1";
+        break;
+    case LOSSES:
+        filters += " AND winner IS NOT NULL AND winner != 0 AND winner != ?1";
+        break;
+    case DRAWS:
+        filters += " AND (winner IS NULL OR winner = 0)";
+        break;
+    default:
+        break;
+    }
+    if (query.after.id > 0) {
+        filters += " AND (timestamp, id) < (?3, ?4)";
+    }
+
+    // One branch per player column so each side is an ordered index range
+    // scan; the outer query merges them and fetches one extra row to detect
+    // whether another page exists
+    const string columns = "id, player1_id, player2_id, winner, move_data, timestamp, game_mode, moves";
+    auto tier = [&](const string& games, const string& positions) {
+        string tierFilters = filters;
+        if (query.positionKey >= 0) {
+            // Probes the (position_key, game_id) primary key per candidate row
+            tierFilters += " AND EXISTS (SELECT 1 FROM " + positions +
+                           " pos WHERE pos.position_key = ?6 AND pos.game_id = g.id)";
+        }
+        return "SELECT * FROM (SELECT " + columns + " FROM " + games + " g "
+               "WHERE player1_id = ?1" + tierFilters +
+               " ORDER BY timestamp DESC, id DESC LIMIT ?5) "
+               "UNION ALL "
+               "SELECT * FROM (SELECT " + columns + " FROM " + games + " g "
+               "WHERE player2_id = ?1 AND player1_id != ?1" + tierFilters +
+               " ORDER BY timestamp DESC, id DESC LIMIT ?5)";
+    };
+
+    string branches = tier("games", "positions");
+    if (includeArchive) {
+        branches += " UNION ALL " + tier("archive.games", "archive.positions");
+    }
+
+    return "WITH page AS (" + branches + ") "
+           "SELECT p.id, p.player1_id, p.player2_id, p.winner, p.move_data, p.timestamp, p.game_mode, "
+           "u1.username as player1_name, u2.username as player2_name, p.moves "
+           "FROM page p "
+           "LEFT JOIN users u1 ON p.player1_id = u1.id "
+           "LEFT JOIN users u2 ON p.player2_id = u2.id "
+           "ORDER BY p.timestamp DESC, p.id DESC LIMIT ?5";
+}
 
+bool TicTacToeDB::fetchHistoryPage(const string& sql, const HistoryQuery& query, HistoryPage& page, string& boundary) {
+    sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        return history;
+        cerr << "Failed to prepare history query: " << sqlite3_errmsg(db) << endl;
+        return false;
     }
 
-    sqlite3_bind_int(stmt, 1, userId);
-    sqlite3_bind_int(stmt, 2, userId);
+    sqlite3_bind_int(stmt, 1, query.userId);
+    sqlite3_bind_text(stmt, 2, query.gameMode.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, query.after.timestamp.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 4, query.after.id);
+    sqlite3_bind_int(stmt, 5, query.pageSize + 1);
+    sqlite3_bind_int(stmt, 6, query.positionKey);
+
+    page.games.clear();
+    page.games.reserve(query.pageSize);
+    page.hasMore = false;
+    page.next = query.after;
+    boundary.clear();
 
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        GameRecord record;
-        record.id = sqlite3_column_int(stmt, 0);
-        record.player1Id = sqlite3_column_int(stmt, 1);
-        record.player2Id = sqlite3_column_type(stmt, 2) == SQLITE_NULL ?
-                               -1 : sqlite3_column_int(stmt, 2);
-        record.winner = sqlite3_column_type(stmt, 3) == SQLITE_NULL ?
-                            0 : sqlite3_column_int(stmt, 3);
-        record.moves = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        record.timestamp = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        record.gameMode = sqlite3_column_type(stmt, 6) == SQLITE_NULL ?
-                              "Classic" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
-        record.player1Name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
-        record.player2Name = sqlite3_column_type(stmt, 8) == SQLITE_NULL ?
-                                 "AI" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 8));
-
-        history.push_back(record);
+        boundary = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+        if (static_cast<int>(page.games.size()) == query.pageSize) {
+            page.hasMore = true;
+            break;
+        }
+        page.games.push_back(readGameRecord(stmt));
     }
 
     sqlite3_finalize(stmt);
-    return history;
+
+    if (!page.games.empty()) {
+        page.next.timestamp = page.games.back().timestamp;
+        page.next.id = page.games.back().id;
+    }
+    return true;
+}
+
+TicTacToeDB::HistoryPage TicTacToeDB::queryGameHistory(const HistoryQuery& query) {
+    HistoryPage page;
+    page.next = query.after;
+
+    if (query.pageSize <= 0) {
+        return page;
+    }
+
+    // Recent pages come from the hot tier alone. The archive only holds
+    // games up to its newest timestamp, so it is read once a page reaches
+    // back that far (or the hot tier runs out).
+    string boundary;
+    if (!fetchHistoryPage(historySql(query, false), query, page, boundary)) {
+        return page;
+    }
+
+    string newestArchived = newestArchivedTimestamp();
+    if (!newestArchived.empty() && (!page.hasMore || boundary <= newestArchived)) {
+        fetchHistoryPage(historySql(query, true), query, page, boundary);
+    }
+
+    return page;
+}
+
+vector<TicTacToeDB::GameRecord> TicTacToeDB::getGameHistory(int userId) {
+    HistoryQuery query;
+    query.userId = userId;
+    return queryGameHistory(query).games;
 }
 
 TicTacToeDB::UserStats TicTacToeDB::getUserStats(int userId) {
-    UserStats stats = {0, 0, 0, 0, 0.0};
+    UserStats stats = {0, 0, 0, 0, 0.0, INITIAL_RATING};
     sqlite3_stmt* stmt;
 
     string sql = "SELECT COUNT(*) as total_games, "
@@ -274,13 +2505,29 @@ TicTacToeDB::UserStats TicTacToeDB::getUserStats(int userId) {
         stats.wins = sqlite3_column_int(stmt, 1);
         stats.losses = sqlite3_column_int(stmt, 2);
         stats.draws = sqlite3_column_int(stmt, 3);
+    }
+
+    sqlite3_finalize(stmt);
 
-        if (stats.totalGames > 0) {
-            stats.winRate = (double)stats.wins / stats.totalGames * 100.0;
+    // Archived games are counted from the hot summary, never the archive
+    if (sqlite3_prepare_v2(db, "SELECT games, wins, losses, draws FROM archive_summary WHERE user_id = ?",
+                           -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, userId);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            stats.totalGames += sqlite3_column_int(stmt, 0);
+            stats.wins += sqlite3_column_int(stmt, 1);
+            stats.losses += sqlite3_column_int(stmt, 2);
+            stats.draws += sqlite3_column_int(stmt, 3);
         }
+        sqlite3_finalize(stmt);
     }
 
-    sqlite3_finalize(stmt);
+    if (stats.totalGames > 0) {
+        stats.winRate = (double)stats.wins / stats.totalGames * 100.0;
+    }
+
+    // Users without a rated game yet sit at the starting rating
+    stats.rating = loadRating(userId).rating;
     return stats;
 }
 
@@ -288,37 +2535,208 @@ bool TicTacToeDB::deleteGame(int gameId) {
     sqlite3_stmt* stmt;
     string sql = "DELETE FROM games WHERE id = ?";
 
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        cerr << "Failed to prepare delete game statement\n";
-        return false;
-    }
+    beginWrite();
+    bool success = false;
+    try {
+        forgetOpenings("games", "id = ?1", gameId);
+        adjustRollups("games", "id = ?1", gameId, -1);
+        removeArchivedGames("id = ?1", gameId);
+
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            cerr << "Failed to prepare delete game statement\n";
+            rollbackWrite();
+            return false;
+        }
 
-    sqlite3_bind_int(stmt, 1, gameId);
+        sqlite3_bind_int(stmt, 1, gameId);
 
-    bool success = sqlite3_step(stmt) == SQLITE_DONE;
-    sqlite3_finalize(stmt);
+        success = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_finalize(stmt);
+
+        success ? commitWrite() : rollbackWrite();
+    } catch (const exception&) {
+        rollbackWrite();
+        throw;
+    }
 
     return success;
 }
 
 bool TicTacToeDB::deleteAllGamesForUser(int userId) {
-    sqlite3_stmt* stmt;
-    string sql = "DELETE FROM games WHERE player1_id = ? OR player2_id = ?";
-
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        cerr << "Failed to prepare delete statement: " << sqlite3_errmsg(db) << endl;
+    // Recovered abandoned games are part of the user's records too. A purge
+    // that fails midway stays in purge_jobs and is finished by resumePurges().
+    try {
+        purgeUser(userId, false);
+    } catch (const exception& e) {
+        cerr << "Failed to delete games: " << e.what() << endl;
         return false;
     }
+    return true;
+}
 
+// PURGE
+
+namespace {
+
+// Every game of ?1 in either tier; each arm is a range read of a player index
+const char* const USER_GAME_IDS =
+    "SELECT id FROM main.games WHERE player1_id = ?1 "
+    "UNION SELECT id FROM main.games WHERE player2_id = ?1 "
+    "UNION SELECT id FROM archive.games WHERE player1_id = ?1 "
+    "UNION SELECT id FROM archive.games WHERE player2_id = ?1";
+
+}
+
+bool TicTacToeDB::loadPurge(int userId, PurgeProgress& progress) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT delete_account, games_total, games_deleted FROM purge_jobs WHERE user_id = ?",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        throw runtime_error("Failed to prepare purge lookup");
+    }
     sqlite3_bind_int(stmt, 1, userId);
-    sqlite3_bind_int(stmt, 2, userId);
 
-    bool success = sqlite3_step(stmt) == SQLITE_DONE;
+    progress = PurgeProgress();
+    progress.userId = userId;
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    if (found) {
+        progress.deleteAccount = sqlite3_column_int(stmt, 0) != 0;
+        progress.gamesTotal = sqlite3_column_int(stmt, 1);
+        progress.gamesDeleted = sqlite3_column_int(stmt, 2);
+    }
+    progress.finished = !found;
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+TicTacToeDB::PurgeProgress TicTacToeDB::startPurge(int userId, bool deleteAccount) {
+    // A purge already under way keeps its counts; asking to delete the
+    // account as well widens it
+    beginWrite();
+    try {
+        sqlite3_stmt* stmt;
+        string sql = "INSERT INTO purge_jobs (user_id, delete_account, games_total) "
+                     "VALUES (?1, ?2, (SELECT COUNT(*) FROM (" + string(USER_GAME_IDS) + "))) "
+                     "ON CONFLICT(user_id) DO UPDATE SET delete_account = MAX(delete_account, excluded.delete_account)";
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            throw runtime_error("Failed to prepare purge");
+        }
+        sqlite3_bind_int(stmt, 1, userId);
+        sqlite3_bind_int(stmt, 2, deleteAccount ? 1 : 0);
+        int result = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+        if (result != SQLITE_DONE) {
+            throw runtime_error("Failed to start purge");
+        }
+        commitWrite();
+    } catch (const exception&) {
+        rollbackWrite();
+        throw;
+    }
+
+    PurgeProgress progress;
+    loadPurge(userId, progress);
+    return progress;
+}
+
+TicTacToeDB::PurgeProgress TicTacToeDB::purgeStep(int userId, int batchSize) {
+    PurgeProgress progress;
+    string username;
+
+    beginWrite();
+    try {
+        if (!loadPurge(userId, progress)) {
+            commitWrite();
+            return progress;
+        }
+
+        // Games first, both tiers at once, so a game caught between the two
+        // archiving transactions is handled like deleteGame handles it
+        executeSQL("CREATE TEMP TABLE IF NOT EXISTS purge_batch (id INTEGER PRIMARY KEY);");
+        executeSQL("DELETE FROM temp.purge_batch;");
+
+        sqlite3_stmt* stmt;
+        string sql = "INSERT INTO temp.purge_batch SELECT id FROM (" + string(USER_GAME_IDS) + ") LIMIT ?2";
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            throw runtime_error("Failed to prepare purge batch");
+        }
+        sqlite3_bind_int(stmt, 1, userId);
+        sqlite3_bind_int(stmt, 2, batchSize);
+        bool selected = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_finalize(stmt);
+        if (!selected) {
+            throw runtime_error("Failed to select games to purge");
+        }
+        int games = sqlite3_changes(db);
+
+        if (games > 0) {
+            const string batch = "id IN (SELECT id FROM temp.purge_batch)";
+            forgetOpenings("games", batch, 0);
+            adjustRollups("games", batch, 0, -1);
+            removeArchivedGames(batch, 0);
+
+            // Hot positions follow through ON DELETE CASCADE
+            executeSQL("DELETE FROM games WHERE " + batch + ";");
+            executeWithId("UPDATE purge_jobs SET games_deleted = games_deleted + " + to_string(games) +
+                          " WHERE user_id = ?1", userId);
+            progress.gamesDeleted += games;
+        } else {
+            executeWithId("DELETE FROM abandoned_games WHERE id IN ("
+                          "SELECT id FROM abandoned_games WHERE player1_id = ?1 "
+                          "UNION SELECT id FROM abandoned_games WHERE player2_id = ?1 "
+                          "LIMIT " + to_string(batchSize) + ")", userId);
+
+            // Nothing references the user any more, so the cascade from
+            // users has nothing left to scan
+            if (sqlite3_changes(db) == 0) {
+                if (progress.deleteAccount) {
+                    username = getUsernameById(userId);
+                    executeWithId("DELETE FROM users WHERE id = ?1", userId);
+                }
+
+                // Elo depends on the order of play, so the opponents' ratings
+                // and counts are replayed without the purged games. That
+                // reads the whole history, so it runs as its own batches.
+                queueRatingRebuild();
+                executeWithId("DELETE FROM purge_jobs WHERE user_id = ?1", userId);
+                progress.finished = true;
+            }
+        }
+
+        commitWrite();
+    } catch (const exception&) {
+        rollbackWrite();
+        throw;
+    }
+
+    if (progress.finished && progress.deleteAccount) {
+        users->forget(username);
+        SessionStore::getInstance()->closeAllForUser(userId);
+    }
+    return progress;
+}
 
-    if (!success) {
-        cerr << "Failed to delete games: " << sqlite3_errmsg(db) << endl;
+void TicTacToeDB::purgeUser(int userId, bool deleteAccount, int batchSize) {
+    PurgeProgress progress = startPurge(userId, deleteAccount);
+    while (!progress.finished) {
+        progress = purgeStep(userId, batchSize);
     }
+    while (resumeRatingRebuild()) {
+    }
+}
 
+int TicTacToeDB::resumePurges(int batchSize) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT user_id FROM purge_jobs ORDER BY started_at, user_id LIMIT 1",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        return 0;
+    }
+    int userId = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : -1;
     sqlite3_finalize(stmt);
-    return success;
+
+    if (userId == -1) {
+        return 0;
+    }
+
+    purgeStep(userId, batchSize);
+    return 1;
 }
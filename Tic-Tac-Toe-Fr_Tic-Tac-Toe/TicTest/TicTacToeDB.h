@@ -5,16 +5,35 @@
 #include <string>
 #include <sqlite3.h>
 #include <vector>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include "picosha2.h"
+#include "MoveCodec.h"
+#include "PositionKey.h"
 
 using namespace std;
 
-// Secure SHA-256 hash function using PicoSHA2
+// Plain SHA-256 (see Sha256.h); also the unsalted password format of older
+// databases, which PasswordHasher still verifies
 string sha256Hash(const string& input);
 
+class UserDirectory;
+
 class TicTacToeDB {
 private:
     sqlite3* db;
+    string databaseLocation;
+    shared_ptr<UserDirectory> users; // Name cache of this database
+    bool holdsWriteTurn; // This connection has a WriteQueue turn
+
+    // Write transactions: a WriteQueue turn around BEGIN IMMEDIATE ... COMMIT
+    // or ROLLBACK. rollbackWrite() is safe to call when nothing is open.
+    void beginWrite();
+    void commitWrite();
+    void rollbackWrite();
+    void releaseWriteTurn();
+    static int busyHandler(void* data, int retries);
 
     void executeSQL(const string& sql) {
         char* errMsg = nullptr;
@@ -25,13 +44,137 @@ private:
         }
     }
 
+    // Schema versioning (PRAGMA user_version)
+    void migrateSchema();
+    bool columnExists(const string& table, const string& column);
+    long long pragmaValue(const string& pragma); // First column of the first row, -1 on failure
+    void migrateLegacyMoves();
+
+    static void readMoveColumns(sqlite3_stmt* stmt, int blobColumn, int textColumn, vector<uint8_t>& out);
+
+    int insertGame(int player1Id, int player2Id, int winner, const vector<uint8_t>& moveData, int plyCount, const string& gameMode);
+    void indexPositions(int gameId, const vector<uint8_t>& moveData);
+    void recordOpenings(const vector<uint8_t>& moveData, const string& gameMode, int delta);
+    void forgetOpenings(const string& table, const string& condition, int id);
+
+    // Cold storage: archive.games and archive.positions in an attached file
+    void attachArchive();
+    static sqlite3* openConnection(const string& location);
+    static void copyDatabase(sqlite3* source, const char* sourceName, sqlite3* target, const char* targetName);
+    int finishPendingArchive(); // Completes the batch in archive_pending; returns games moved
+    void executeWithId(const string& sql, int id); // Binds id to ?1
+    void adjustArchiveSummary(const string& table, const string& condition, int id, int sign);
+    void removeArchivedGames(const string& condition, int id);
+
+    // Adds (sign 1) or takes back (sign -1) games of `table` matching
+    // condition in game_rollups; countAllRollups() adds both tiers
+    void adjustRollups(const string& table, const string& condition, int id, int sign);
+    void countAllRollups();
+    string newestArchivedTimestamp();
+
+    // Elo ratings (v6); AI levels are rated players with negative ids
+    struct Rating {
+        double rating = INITIAL_RATING;
+        int games = 0;
+        int wins = 0;
+        int losses = 0;
+        int draws = 0;
+    };
+
+    // Standard Elo update; score is a's result (1 win, 0.5 draw, 0 loss)
+    static void applyElo(Rating& a, Rating& b, double score);
+    Rating loadRating(int playerId, const string& table = "ratings");
+    void storeRating(int playerId, const Rating& rating, const string& table = "ratings");
+    void updateRatings(int player1Id, int player2Id, int winner, const string& gameMode);
+    int replayRatings();
+    void queueRatingRebuild(); // Inside a write transaction
+
+    using GameVisitor = function<void(int gameId, const vector<uint8_t>& moveData, const string& gameMode)>;
+
+    // Calls visit for up to `limit` games (-1 = no limit) with
+    // afterId < id <= upToId, in id order; returns how many, and the last
+    // id visited through lastId
+    int visitGames(int afterId, int upToId, int limit, const GameVisitor& visit, int& lastId);
+
+    // Feeds stored games up to the id recorded in index_state to indexGame,
+    // one batch per transaction
+    int backfill(const char* indexName, int batchSize, const GameVisitor& indexGame);
+
 public:
     TicTacToeDB();
+    explicit TicTacToeDB(const string& location);
     ~TicTacToeDB();
 
+    // Where connections opened with the default constructor point: a file
+    // path, ":memory:" (private to one connection) or a "file:" URI. For a
+    // memory database every connection of the process shares, use
+    // "file:/<name>?vfs=memdb"; "file:<name>?mode=memory&cache=shared" works
+    // too, with dirty reads. Defaults to $TICTACTOE_DB, else tictactoe.db.
+    static void setLocation(const string& location);
+    static string location();
+
+    // The archive lives next to the database: tictactoe.db ->
+    // tictactoe_archive.db, file:/games?vfs=memdb -> file:/games_archive?vfs=memdb
+    static string archiveLocation(const string& location);
+
+    // File system path of a location, e.g. for files kept beside the
+    // database; empty for memory databases
+    static string filePath(const string& location);
+
+    // Online backup of the database and its archive to another location,
+    // e.g. to keep what a memory database collected. Writers are held off
+    // for one small step at a time only.
+    void backupTo(const string& location);
+
+    // Replaces the contents of this database and its archive with a copy
+    // of another location, then brings the copy up to the current schema
+    void restoreFrom(const string& location);
+
+    // Maintenance steps for MaintenanceScheduler; schema is "main" or
+    // "archive". Each takes at most one short write turn.
+    static const int JOURNAL_SIZE_LIMIT = 4 * 1024 * 1024; // WAL bytes kept after a checkpoint
+
+    bool incrementalVacuumEnabled(const string& schema);
+    int freePages(const string& schema);
+    int pageSize(const string& schema);
+    long long fileSize(const string& schema); // Bytes in use by pages
+
+    // Releases up to `pages` free pages; returns how many were released.
+    // With WAL the file shrinks at the next checkpoint.
+    int incrementalVacuum(const string& schema, int pages);
+
+    // PRAGMA optimize with a bounded ANALYZE, over both files
+    void optimize();
+
+    // Passive WAL checkpoint; returns the frames copied into the database
+    int checkpoint(const string& schema);
+
+    // Full VACUUM of both files, returning the bytes reclaimed. Blocks every
+    // writer for as long as it takes, so it is for the command line only;
+    // it also switches files created before incremental vacuum over to it.
+    long long vacuum();
+    // The same for one file; MaintenanceScheduler uses it to convert small
+    // files while the game is idle
+    long long vacuum(const string& schema);
+
+    // Abort the statement currently running on this connection; safe to
+    // call from any thread
+    void interrupt() { sqlite3_interrupt(db); }
+
     // User Management (Login functionality)
+    // Both hash with PasswordHasher, which is slow by design; the GUI does
+    // the hashing on a worker and only uses the *Hash calls below
     bool createUser(const string& username, const string& password);
     bool validateUser(const string& username, const string& password);
+    static bool acceptableCredentials(const string& username, const string& password);
+    bool createUserWithHash(const string& username, const string& passwordHash);
+    bool getPasswordHash(const string& username, int& userId, string& passwordHash);
+    // Compare-and-swap, so a concurrent password change is never overwritten
+    bool replacePasswordHash(int userId, const string& oldHash, const string& newHash);
+    // Cost for new hashes, kept in settings so that it only ever goes up:
+    // a slower or busier run calibrating lower must not make every login
+    // rehash. Stores `calibrated` if it is higher; returns the cost to use.
+    int raisePasswordCost(int calibrated);
     bool deleteUser(const string& username);
     int getUserId(const string& username);
     bool userExists(const string& username);
@@ -39,6 +182,12 @@ public:
 
     // Game Management (History functionality)
     void saveGame(int player1Id, int player2Id, int winner, const vector<string>& moves, const string& gameMode = "Classic");
+    void saveGame(int player1Id, int player2Id, int winner, const vector<uint8_t>& moveData, int plyCount, const string& gameMode = "Classic");
+    // Unfinished game recovered from a crash journal (timestamp as "YYYY-MM-DD HH:MM:SS")
+    void saveAbandonedGame(int player1Id, int player2Id, const vector<uint8_t>& moveData, int plyCount,
+                           const string& gameMode, const string& lastMoveAt = "");
+    // Runs purgeUser() to completion, as deleteUser() does with the account;
+    // false if a step failed
     bool deleteAllGamesForUser(int userId);
     bool deleteGame(int gameId);
 
@@ -47,7 +196,7 @@ public:
         int player1Id;
         int player2Id;
         int winner;
-        string moves;
+        vector<uint8_t> moveData; // MoveCodec packed moves
         string timestamp;
         string player1Name;
         string player2Name;
@@ -60,10 +209,192 @@ public:
         int losses;
         int draws;
         double winRate;
+        double rating;
+    };
+
+    // Paginated history (keyset on timestamp, id; newest first)
+    enum ResultFilter {
+        ANY_RESULT = 0,
+        WINS = 1,
+        LOSSES = 2,
+        DRAWS = 3
     };
 
+    struct HistoryCursor {
+        string timestamp;
+        int id = 0; // 0 = start from the newest game
+    };
+
+    struct HistoryQuery {
+        int userId = -1;
+        string gameMode;  // Empty = all modes
+        ResultFilter result = ANY_RESULT;
+        int positionKey = -1; // PositionKey::canonical; -1 = any game
+        HistoryCursor after;
+        int pageSize = 50;
+    };
+
+    struct HistoryPage {
+        vector<GameRecord> games;
+        HistoryCursor next;
+        bool hasMore = false;
+    };
+
+    HistoryPage queryGameHistory(const HistoryQuery& query);
     vector<GameRecord> getGameHistory(int userId);
     UserStats getUserStats(int userId);
+
+    // Elo ratings, updated by saveGame. Users are rated under their id, the
+    // AI under aiRatingId(level). Purging a user's games queues a rebuild
+    // from the remaining history (resumeRatingRebuild); deleteGame() leaves
+    // ratings as they are. recomputeRatings() rebuilds them in one go.
+    static constexpr double INITIAL_RATING = 1200.0;
+    static constexpr double RATING_K = 32.0;
+
+    static int aiRatingId(int aiLevel) { return -aiLevel; }
+
+    struct RatingEntry {
+        int playerId;
+        string name;
+        double rating;
+        int games;
+        int wins;
+        int losses;
+        int draws;
+    };
+
+    // Highest rated first; an index range scan of `limit` rows
+    vector<RatingEntry> getLeaderboard(int limit = 10);
+
+    // Replays every game in play order with one cursor; returns the rated
+    // game count
+    int recomputeRatings();
+
+    // One batch of a queued rating rebuild: the next batchSize games in play
+    // order are replayed into rating_shadow, which replaces ratings once the
+    // replay catches up. Ratings keep their old values until then. Returns
+    // 0 when no rebuild is queued.
+    int resumeRatingRebuild(int batchSize = 500);
+
+    // Moves one batch of games older than `days` into the archive tier and
+    // returns how many moved, 0 once none are left. History, statistics,
+    // exports and deletes keep covering archived games; only the hot
+    // database shrinks. Waits (returns 0) while an index backfill is pending.
+    int archiveGamesOlderThan(int days, int batchSize = 1000);
+
+    // Archive transfer in the GameArchive format. Both directions stream;
+    // memory is bounded by one import batch plus the username -> id map.
+    struct ArchiveStats {
+        int users = 0;      // Users written, or created by the import
+        int games = 0;      // Games written or imported
+        int duplicates = 0; // Games already in the database, skipped
+        int rejected = 0;   // Malformed lines or unknown players, skipped
+    };
+
+    ArchiveStats exportArchive(ostream& out);
+
+    // Commits every batchSize games; positions and the opening tree are
+    // built per batch once its rows are in, and ratings once at the end
+    ArchiveStats importArchive(istream& in, int batchSize = 5000);
+
+    // Indexes one batch of games stored before the position index existed;
+    // returns how many were indexed, 0 once the backfill is complete
+    int backfillPositions(int batchSize = 500);
+
+    // Opening tree: outcome counts for every move played from a position,
+    // kept per mode and AI level and folded by symmetry
+    static const int OPENING_DEPTH = 9; // Plies per game that are counted
+
+    struct OpeningMove {
+        int cell; // row * 3 + col on the board that was queried
+        int xWins;
+        int oWins;
+        int draws;
+
+        int games() const { return xWins + oWins + draws; }
+    };
+
+    // Moves played from `board` in games of `gameMode`, most played first.
+    // One primary key range read, so walking a line costs one query per ply.
+    vector<OpeningMove> queryOpenings(const char* board, const string& gameMode);
+
+    // Same contract as backfillPositions, for the opening tree
+    int backfillOpenings(int batchSize = 500);
+
+    // Game counts per hour, day and month for every mode and AI level,
+    // covering both tiers. saveGame, deletes and imports keep them current,
+    // so reports never scan the games. Buckets are UTC, as the timestamps.
+    enum RollupGrain {
+        HOURLY = 0,
+        DAILY = 1,
+        MONTHLY = 2
+    };
+
+    struct RollupQuery {
+        RollupGrain grain = DAILY;
+        string from;     // First bucket, inclusive; empty = open
+        string to;       // Last bucket, inclusive; empty = open
+        string gameMode; // Empty = all modes, else as stored ("AI Hard")
+    };
+
+    struct RollupRow {
+        string bucket;   // "YYYY-MM-DD HH:00", "YYYY-MM-DD" or "YYYY-MM"
+        string gameMode; // "Classic Mode", "Overwrite Mode", "AI Easy", ...
+        int games;
+        int totalMoves;  // Sum of game_duration
+        int player1Wins;
+        int player2Wins; // Human opponents only
+        int aiWins;
+        int draws;
+
+        double averageMoves() const { return games > 0 ? static_cast<double>(totalMoves) / games : 0.0; }
+        double aiWinRate() const { return games > 0 ? static_cast<double>(aiWins) / games : 0.0; }
+    };
+
+    // Rows in bucket order, then mode. Bounds compare as text against
+    // bucket names, so they are given in the format of the grain.
+    vector<RollupRow> queryRollups(const RollupQuery& query);
+
+    // The same rows as CSV with a header line; returns the row count
+    int exportRollupsCsv(const RollupQuery& query, ostream& out);
+
+    // Recounts every game, e.g. after timestamps were edited by hand
+    void rebuildRollups();
+
+    // Purges of a user's games, and optionally the account, in chunks of
+    // batchSize games per short transaction. Each chunk takes its games out
+    // of both tiers together with their opening counts, rollups, archive
+    // summary and positions. The job is recorded in purge_jobs, so a purge
+    // that is interrupted carries on with resumePurges() or the next
+    // startPurge() for the same user. The last step queues a rating rebuild
+    // (resumeRatingRebuild), after which opponents stand as if the purged
+    // games had never been played; purgeUser() runs it to the end.
+    struct PurgeProgress {
+        int userId = -1;
+        bool deleteAccount = false;
+        int gamesTotal = 0;   // Games the user had when the purge started
+        int gamesDeleted = 0; // Can pass gamesTotal if games arrive meanwhile
+        bool finished = false;
+    };
+
+    PurgeProgress startPurge(int userId, bool deleteAccount);
+    // One chunk; finished once the games, abandoned games and account are gone
+    PurgeProgress purgeStep(int userId, int batchSize = 200);
+    void purgeUser(int userId, bool deleteAccount, int batchSize = 200);
+
+    // One step of the oldest unfinished purge; returns 0 once none is left
+    int resumePurges(int batchSize = 200);
+
+private:
+    GameRecord readGameRecord(sqlite3_stmt* stmt);
+
+    // History pages over the hot tier, optionally merged with the archive;
+    // boundary receives the timestamp of the last row read
+    static string historySql(const HistoryQuery& query, bool includeArchive);
+    bool fetchHistoryPage(const string& sql, const HistoryQuery& query, HistoryPage& page, string& boundary);
+
+    // Fills progress from purge_jobs; false (and finished) if there is no job
+    bool loadPurge(int userId, PurgeProgress& progress);
 };
 
 #endif // TICTACTOEDB_H
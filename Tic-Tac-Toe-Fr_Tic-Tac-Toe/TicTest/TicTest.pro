@@ -9,9 +9,28 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    BoardView.cpp \
+    Diagnostics.cpp \
+    GameArchive.cpp \
+    GameHistoryDelegate.cpp \
+    GameJournal.cpp \
     GameHistoryManager.cpp \
+    GameHistoryModel.cpp \
     GameWindow.cpp \
+    HistoryLoader.cpp \
+    MaintenanceScheduler.cpp \
+    MoveAnalysis.cpp \
+    MoveCodec.cpp \
+    PasswordHasher.cpp \
+    PositionKey.cpp \
+    ReplayTimeline.cpp \
+    SelfCheck.cpp \
+    SessionStore.cpp \
+    Sha256.cpp \
+    StartupProfiler.cpp \
     TicTacToeDB.cpp \
+    UserDirectory.cpp \
+    WriteQueue.cpp \
     ai_game.cpp \
     classic_game.cpp \
     historywindow.cpp \
@@ -21,9 +40,28 @@ SOURCES += \
     sqlite3.c
 
 HEADERS += \
+    BoardView.h \
+    Diagnostics.h \
+    GameArchive.h \
+    GameHistoryDelegate.h \
+    GameJournal.h \
     GameHistoryManager.h \
+    GameHistoryModel.h \
     GameWindow.h \
+    HistoryLoader.h \
+    MaintenanceScheduler.h \
+    MoveAnalysis.h \
+    MoveCodec.h \
+    PasswordHasher.h \
+    PositionKey.h \
+    ReplayTimeline.h \
+    SelfCheck.h \
+    SessionStore.h \
+    Sha256.h \
+    StartupProfiler.h \
     TicTacToeDB.h \
+    UserDirectory.h \
+    WriteQueue.h \
     ai_game.h \
     classic_game.h \
     historywindow.h \
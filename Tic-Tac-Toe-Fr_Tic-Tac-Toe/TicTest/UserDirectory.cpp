@@ -0,0 +1,91 @@
+#include "UserDirectory.h"
+#include "TicTacToeDB.h"
+#include <filesystem>
+
+bool UserDirectory::lookupName(int userId, std::string& username) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = namesById.find(userId);
+    if (it == namesById.end()) {
+        return false;
+    }
+    username = it->second;
+    return true;
+}
+
+bool UserDirectory::lookupId(const std::string& username, int& userId) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = idsByName.find(username);
+    if (it == idsByName.end()) {
+        return false;
+    }
+    userId = it->second;
+    return true;
+}
+
+void UserDirectory::remember(int userId, const std::string& username) {
+    if (userId < 0 || username.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Drop stale pairings in both directions so a re-registered name never
+    // resolves to the id of a deleted account
+    auto byId = namesById.find(userId);
+    if (byId != namesById.end() && byId->second != username) {
+        idsByName.erase(byId->second);
+    }
+    auto byName = idsByName.find(username);
+    if (byName != idsByName.end() && byName->second != userId) {
+        namesById.erase(byName->second);
+    }
+
+    namesById[userId] = username;
+    idsByName[username] = userId;
+}
+
+void UserDirectory::forget(const std::string& username) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = idsByName.find(username);
+    if (it != idsByName.end()) {
+        namesById.erase(it->second);
+        idsByName.erase(it);
+    }
+}
+
+void UserDirectory::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    namesById.clear();
+    idsByName.clear();
+}
+
+std::shared_ptr<UserDirectory> UserDirectory::forDatabase(const std::string& location) {
+    bool privateMemory = location.empty() || location == ":memory:" ||
+                         (location.compare(0, 13, "file::memory:") == 0 &&
+                          location.find("cache=shared") == std::string::npos);
+    if (privateMemory) {
+        return std::shared_ptr<UserDirectory>(new UserDirectory());
+    }
+
+    std::string key = TicTacToeDB::filePath(location);
+    if (key.empty()) {
+        key = location;
+    } else {
+        std::error_code error;
+        std::filesystem::path absolute = std::filesystem::absolute(key, error);
+        if (!error) {
+            key = absolute.lexically_normal().string();
+        }
+    }
+
+    // Kept for the whole run; a process only ever opens a few databases
+    static std::mutex registryMutex;
+    static std::unordered_map<std::string, std::shared_ptr<UserDirectory>> registry;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::shared_ptr<UserDirectory>& directory = registry[key];
+    if (!directory) {
+        directory.reset(new UserDirectory());
+    }
+    return directory;
+}
@@ -0,0 +1,38 @@
+#ifndef USERDIRECTORY_H
+#define USERDIRECTORY_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// id <-> username cache of one database, shared by every TicTacToeDB
+// instance open on it; another database in the same process has its own.
+// Entries are learned from lookups and joined history rows, and dropped when
+// a user is created or deleted through TicTacToeDB.
+class UserDirectory {
+private:
+    mutable std::mutex mutex;
+    std::unordered_map<int, std::string> namesById;
+    std::unordered_map<std::string, int> idsByName;
+
+    UserDirectory() = default;
+
+public:
+    UserDirectory(const UserDirectory&) = delete;
+    UserDirectory& operator=(const UserDirectory&) = delete;
+
+    bool lookupName(int userId, std::string& username) const;
+    bool lookupId(const std::string& username, int& userId) const;
+
+    void remember(int userId, const std::string& username);
+    void forget(const std::string& username);
+    void clear();
+
+    // The cache for a database location (see TicTacToeDB::setLocation). Files
+    // are matched by absolute path and named memory databases by URI; a
+    // private ":memory:" connection gets a cache of its own.
+    static std::shared_ptr<UserDirectory> forDatabase(const std::string& location);
+};
+
+#endif // USERDIRECTORY_H
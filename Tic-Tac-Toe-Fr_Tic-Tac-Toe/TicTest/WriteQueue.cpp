@@ -0,0 +1,73 @@
+#include "WriteQueue.h"
+#include <stdexcept>
+
+namespace {
+// Whether the calling thread holds the turn being served
+thread_local bool holdingTurn = false;
+}
+
+void WriteQueue::acquire() {
+    if (holdingTurn) {
+        throw std::logic_error("Write turn requested by the thread that holds it");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t ticket = nextTicket++;
+    bool waited = ticket != nowServing;
+    turnChanged.wait(lock, [this, ticket]() { return nowServing == ticket; });
+    holdingTurn = true;
+
+    counters.writes++;
+    if (waited) {
+        double waitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        counters.waitedWrites++;
+        counters.totalWaitMs += waitMs;
+        if (waitMs > counters.maxWaitMs) {
+            counters.maxWaitMs = waitMs;
+        }
+    }
+}
+
+void WriteQueue::release() {
+    holdingTurn = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        nowServing++;
+    }
+    // Every waiter checks whether the new number is its own
+    turnChanged.notify_all();
+}
+
+uint64_t WriteQueue::pending() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return nextTicket - nowServing;
+}
+
+void WriteQueue::recordBusyRetry() {
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.busyRetries++;
+}
+
+void WriteQueue::recordBusyFailure() {
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.busyFailures++;
+}
+
+WriteQueue::Metrics WriteQueue::metrics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void WriteQueue::report(std::ostream& out) const {
+    Metrics m = metrics();
+    out << "Database writes: " << m.writes << " (" << m.waitedWrites << " queued, "
+        << static_cast<int>(m.totalWaitMs) << " ms waiting, longest " << static_cast<int>(m.maxWaitMs) << " ms); "
+        << "busy retries: " << m.busyRetries << ", busy failures: " << m.busyFailures << std::endl;
+}
+
+WriteQueue* WriteQueue::getInstance() {
+    static WriteQueue instance;
+    return &instance;
+}
@@ -0,0 +1,58 @@
+#ifndef WRITEQUEUE_H
+#define WRITEQUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+
+// Process-wide turn taking for write transactions. Every TicTacToeDB
+// connection (GUI, history loader, history recorder, index backfill,
+// maintenance) takes a ticket before BEGIN IMMEDIATE and is served strictly
+// in arrival order, so connections of this process never race each other
+// for sqlite's write lock. In WAL mode readers don't need a turn at all.
+//
+// A thread must not start a second write transaction, on any connection,
+// while it holds a turn: it would wait for itself forever. acquire() throws
+// std::logic_error instead, and release() must come from the same thread.
+class WriteQueue {
+public:
+    struct Metrics {
+        uint64_t writes = 0;        // Turns granted
+        uint64_t waitedWrites = 0;  // Turns that had to queue
+        double totalWaitMs = 0;
+        double maxWaitMs = 0;
+        uint64_t busyRetries = 0;   // sqlite busy handler invocations
+        uint64_t busyFailures = 0;  // Statements that gave up with SQLITE_BUSY
+    };
+
+    WriteQueue(const WriteQueue&) = delete;
+    WriteQueue& operator=(const WriteQueue&) = delete;
+
+    void acquire(); // Throws std::logic_error if this thread holds a turn
+    void release();
+
+    // Turns held or waited for right now; background work backs off while
+    // this is above zero
+    uint64_t pending() const;
+
+    void recordBusyRetry();
+    void recordBusyFailure();
+
+    Metrics metrics() const;
+    void report(std::ostream& out) const;
+
+    static WriteQueue* getInstance();
+
+private:
+    WriteQueue() = default;
+
+    mutable std::mutex mutex;
+    std::condition_variable turnChanged;
+    uint64_t nextTicket = 0;
+    uint64_t nowServing = 0;
+    Metrics counters;
+};
+
+#endif // WRITEQUEUE_H
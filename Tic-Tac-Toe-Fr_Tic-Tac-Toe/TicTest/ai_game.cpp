@@ -1,4 +1,5 @@
 #include "ai_game.h"
+#include "MoveAnalysis.h"
 
 void startAIGame(int difficulty) {
     GameState game;
@@ -105,65 +106,24 @@ AIMove getMediumMove(const GameState* game) {
 }
 
 AIMove getHardMove(const GameState* game) {
-    vector<AIMove> availableMoves = getAvailableMoves(game);
-
-    if (availableMoves.empty()) {
-        return AIMove(-1, -1, 0);
-    }
-
-    AIMove bestMove(-1, -1, -1000);
-
-    for (const auto& move : availableMoves) {
-        GameState tempGame = *game;
-        tempGame.board[move.row][move.col] = 'O';
-
-        int score = minimax(&tempGame, 0, false, 'O', 'X');
-
-        if (score > bestMove.score) {
-            bestMove = AIMove(move.row, move.col, score);
+    char board[PositionKey::CELLS];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            board[i * 3 + j] = game->board[i][j];
         }
     }
 
-    return bestMove;
-}
-
-int minimax(GameState* game, int depth, bool isMaximizing, char aiPlayer, char humanPlayer) {
-    // Check terminal states
-    game->currentPlayer = aiPlayer;
-    if (checkWin(game)) return 10 - depth;
-
-    game->currentPlayer = humanPlayer;
-    if (checkWin(game)) return depth - 10;
-
-    if (isBoardFull(game)) return 0;
-
-    if (isMaximizing) {
-        int maxEval = -1000;
-        for (int i = 0; i < 3; i++) {
-            for (int j = 0; j < 3; j++) {
-                if (game->board[i][j] == ' ') {
-                    game->board[i][j] = aiPlayer;
-                    int eval = minimax(game, depth + 1, false, aiPlayer, humanPlayer);
-                    game->board[i][j] = ' ';
-                    maxEval = max(maxEval, eval);
-                }
-            }
-        }
-        return maxEval;
-    } else {
-        int minEval = 1000;
-        for (int i = 0; i < 3; i++) {
-            for (int j = 0; j < 3; j++) {
-                if (game->board[i][j] == ' ') {
-                    game->board[i][j] = humanPlayer;
-                    int eval = minimax(game, depth + 1, true, aiPlayer, humanPlayer);
-                    game->board[i][j] = ' ';
-                    minEval = min(minEval, eval);
-                }
-            }
-        }
-        return minEval;
+    // Perfect play from the session-wide table instead of a fresh search
+    vector<MoveAnalysis::MoveScore> scores = MoveAnalysis::scoreMoves(board, 'O');
+    if (scores.empty()) {
+        return AIMove(-1, -1, 0);
     }
+
+    // Usual minimax scale: 10 minus the plies after this move for a win,
+    // negated for a loss, 0 for a draw
+    const MoveAnalysis::MoveScore& best = scores.front();
+    int score = best.outcome == MoveAnalysis::DRAW ? 0 : best.outcome * (11 - best.distance);
+    return AIMove(best.row(), best.col(), score);
 }
 
 bool isBoardFull(const GameState* game) {
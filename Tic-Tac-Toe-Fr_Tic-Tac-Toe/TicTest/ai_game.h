@@ -24,7 +24,6 @@ AIMove getAIMove(const GameState* game, AILevel level);
 AIMove getEasyMove(const GameState* game);
 AIMove getMediumMove(const GameState* game);
 AIMove getHardMove(const GameState* game);
-int minimax(GameState* game, int depth, bool isMaximizing, char aiPlayer, char humanPlayer);
 bool isBoardFull(const GameState* game);
 vector<AIMove> getAvailableMoves(const GameState* game);
 
@@ -1,39 +1,122 @@
 #include "HistoryWindow.h"
+#include "SessionStore.h"
 #include <QMessageBox>
 #include <QSplitter>
 #include <QFrame>
 
-HistoryWindow::HistoryWindow(const QString& username, QWidget *parent)
-    : QDialog(parent), currentUser(username), currentUserId(-1),
-    currentMoveIndex(0), replaySpeed(1000), isReplaying(false), isPaused(false)
+HistoryWindow::HistoryWindow(QWidget *parent)
+    : QDialog(parent), currentUserId(-1),
+    currentMoveCount(0), currentMoveIndex(0), positionFilter(-1), openingRequest(0), replaySpeed(1000), isReplaying(false), isPaused(false)
 {
-    setWindowTitle("Game History - " + username);
+    setWindowTitle("Game History");
     setMinimumSize(1200, 800);
 
-    try {
-        database = new TicTacToeDB();
-        currentUserId = database->getUserId(username.toStdString());
+    replayTimer = new QTimer(this);
+    connect(replayTimer, &QTimer::timeout, this, &HistoryWindow::onReplayStep);
+
+    setupUI();
+
+    // Every query runs on the loader's thread so the dialog paints at once;
+    // results stream back through queued signals
+    historyLoader = new HistoryLoader();
+    connect(historyLoader, &HistoryLoader::busyChanged, this, &HistoryWindow::onLoaderBusyChanged);
+    connect(historyLoader, &HistoryLoader::statsLoaded, this, &HistoryWindow::onStatsLoaded);
+    connect(historyLoader, &HistoryLoader::purgeProgress, this, &HistoryWindow::onPurgeProgress);
+    connect(historyLoader, &HistoryLoader::gamesDeleted, this, &HistoryWindow::onGamesDeleted);
+    connect(historyLoader, &HistoryLoader::openingsLoaded, this, &HistoryWindow::onOpeningsLoaded);
+    connect(historyLoader, &HistoryLoader::failed, this, &HistoryWindow::onLoaderFailed);
+    connect(historyLoader, &HistoryLoader::pageLoaded, historyModel, &GameHistoryModel::applyPage);
+
+    connect(historyModel, &GameHistoryModel::pageRequested, this,
+            [this](int generation, int pageIndex, const TicTacToeDB::HistoryQuery& query) {
+                historyLoader->supersede(generation);
+                historyLoader->requestPage(generation, pageIndex, query);
+            });
+    connect(historyModel, &GameHistoryModel::pageApplied, this, [this]() {
+        emptyHistoryLabel->setVisible(historyModel->isEmpty());
+    });
+}
 
-        if (currentUserId == -1) {
-            QMessageBox::warning(this, "Error", "User not found!");
-            return;
-        }
+void HistoryWindow::setSession(const std::string& token)
+{
+    // Drop anything still in flight for the previous visit
+    historyLoader->cancel();
+    onStopReplay();
+    replayTimeline.clear();
+    currentMoveCount = 0;
+    currentGameMode.clear();
+    clearBoard();
+    updateReplayControls();
 
-        replayTimer = new QTimer(this);
-        connect(replayTimer, &QTimer::timeout, this, &HistoryWindow::onReplayStep);
+    // Resolved from the session; the users table is not consulted
+    SessionStore::Session session;
+    SessionStore::getInstance()->lookup(token, session);
+    sessionToken = token;
+    currentUser = QString::fromStdString(session.username);
+    currentUserId = session.userId;
+    setWindowTitle("Game History - " + currentUser);
+
+    // Filters start from "all" on every visit without firing a reload each
+    gameModeFilter->blockSignals(true);
+    resultFilter->blockSignals(true);
+    gameModeFilter->setCurrentIndex(0);
+    resultFilter->setCurrentIndex(0);
+    gameModeFilter->blockSignals(false);
+    resultFilter->blockSignals(false);
+
+    positionFilter = -1;
+    similarButton->setText("🔍 Similar Games");
+
+    emptyHistoryLabel->hide();
+    historyModel->setFilter(-1, std::string(), TicTacToeDB::ANY_RESULT);
+    removeHistoryButton->setEnabled(true);
+
+    if (currentUserId == -1) {
+        statsLabel->clear();
+        QMessageBox::warning(this, "Error", "Your session has expired. Please log in again.");
+        return;
+    }
 
-        setupUI();
-        loadGameHistory();
-        updateStats();
+    statsLabel->setText("Loading statistics...");
+    loadGameHistory();
+    updateStats();
+}
 
-    } catch (const std::exception& e) {
-        QMessageBox::critical(this, "Database Error", e.what());
+HistoryWindow::~HistoryWindow()
+{
+    // Interrupts the running query and joins the worker thread
+    delete historyLoader;
+}
+
+void HistoryWindow::done(int result)
+{
+    // Stop background work as soon as the dialog is dismissed
+    historyLoader->cancel();
+    replayTimer->stop();
+    QDialog::done(result);
+}
+
+bool HistoryWindow::sessionValid()
+{
+    // Destructive actions re-check that the session is still live and still
+    // belongs to the user shown
+    SessionStore::Session session;
+    if (SessionStore::getInstance()->lookup(sessionToken, session) && session.userId == currentUserId) {
+        return true;
     }
+
+    QMessageBox::warning(this, "Error", "Your session has expired. Please log in again.");
+    return false;
 }
 
-HistoryWindow::~HistoryWindow()
+void HistoryWindow::onLoaderBusyChanged()
 {
-    delete database;
+    loadingBar->setVisible(historyLoader->isBusy());
+}
+
+void HistoryWindow::onLoaderFailed(const QString& message)
+{
+    QMessageBox::critical(this, "Database Error", message);
 }
 
 void HistoryWindow::setupUI()
@@ -71,12 +154,13 @@ void HistoryWindow::setupUI()
 
     gameModeFilter = new QComboBox();
     gameModeFilter->setFixedHeight(40); // Increase height for better appearance
-    gameModeFilter->addItem("All Games");
-    gameModeFilter->addItem("Classic");
-    gameModeFilter->addItem("Overwrite");
-    gameModeFilter->addItem("AI Easy");
-    gameModeFilter->addItem("AI Medium");
-    gameModeFilter->addItem("AI Hard");
+    // Item data holds the game_mode value stored by GameWindow
+    gameModeFilter->addItem("All Games", QString());
+    gameModeFilter->addItem("Classic", "Classic Mode");
+    gameModeFilter->addItem("Overwrite", "Overwrite Mode");
+    gameModeFilter->addItem("AI Easy", "AI Easy");
+    gameModeFilter->addItem("AI Medium", "AI Medium");
+    gameModeFilter->addItem("AI Hard", "AI Hard");
 
     // Enhanced modern styling
     gameModeFilter->setStyleSheet(
@@ -149,6 +233,15 @@ void HistoryWindow::setupUI()
 
     connect(gameModeFilter, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &HistoryWindow::onFilterChanged);
 
+    resultFilter = new QComboBox();
+    resultFilter->setFixedHeight(40);
+    resultFilter->addItem("All Results", TicTacToeDB::ANY_RESULT);
+    resultFilter->addItem("Wins", TicTacToeDB::WINS);
+    resultFilter->addItem("Losses", TicTacToeDB::LOSSES);
+    resultFilter->addItem("Draws", TicTacToeDB::DRAWS);
+    resultFilter->setStyleSheet(gameModeFilter->styleSheet());
+    connect(resultFilter, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &HistoryWindow::onFilterChanged);
+
     refreshButton = new QPushButton("🔄 Refresh");
     refreshButton->setFixedSize(120, 35);
     refreshButton->setStyleSheet(
@@ -200,6 +293,7 @@ void HistoryWindow::setupUI()
 
     filterLayout->addWidget(new QLabel("Filter by Mode:"));
     filterLayout->addWidget(gameModeFilter);
+    filterLayout->addWidget(resultFilter);
     filterLayout->addStretch();
     filterLayout->addWidget(refreshButton);
     filterLayout->addWidget(removeHistoryButton);
@@ -224,6 +318,23 @@ void HistoryWindow::setupUI()
         "}"
         );
     mainLayout->addWidget(statsLabel);
+
+    // Indeterminate bar shown while the loader has queries in flight
+    loadingBar = new QProgressBar();
+    loadingBar->setRange(0, 0);
+    loadingBar->setFixedHeight(4);
+    loadingBar->setTextVisible(false);
+    loadingBar->setStyleSheet(
+        "QProgressBar {"
+        "border: none;"
+        "background-color: #e9ecef;"
+        "}"
+        "QProgressBar::chunk {"
+        "background-color: #4A90E2;"
+        "}"
+        );
+    loadingBar->hide();
+    mainLayout->addWidget(loadingBar);
     mainLayout->addSpacing(8);
 
     contentLayout = new QHBoxLayout();
@@ -265,12 +376,19 @@ void HistoryWindow::setupUI()
 
     QVBoxLayout *historyLayout = new QVBoxLayout(historyGroup);
 
-    gameHistoryList = new QListWidget();
-    gameHistoryList->setSelectionMode(QAbstractItemView::SingleSelection);
-    gameHistoryList->setSelectionBehavior(QAbstractItemView::SelectRows);
-    gameHistoryList->setFocusPolicy(Qt::StrongFocus);
-    gameHistoryList->setStyleSheet(
-        "QListWidget {"
+    // Rows are paged in by the model as the view scrolls
+    historyModel = new GameHistoryModel(this);
+
+    gameHistoryView = new QListView();
+    gameHistoryView->setModel(historyModel);
+    gameHistoryView->setItemDelegate(new GameHistoryDelegate(gameHistoryView));
+    gameHistoryView->setUniformItemSizes(true);
+    gameHistoryView->setMouseTracking(true);
+    gameHistoryView->setSelectionMode(QAbstractItemView::SingleSelection);
+    gameHistoryView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    gameHistoryView->setFocusPolicy(Qt::StrongFocus);
+    gameHistoryView->setStyleSheet(
+        "QListView {"
         "border: 1px solid #ced4da;"
         "border-radius: 8px;"
         "background-color: white;"
@@ -278,27 +396,16 @@ void HistoryWindow::setupUI()
         "font-size: 14px;"
         "font-family: 'Segoe UI', Arial, sans-serif;"
         "}"
-        "QListWidget::item {"
-        "padding: 8px;"
-        "border-bottom: 1px solid #e9ecef;"
-        "color: #333333;"
-        "}"
-        "QListWidget::item:hover {"
-        "background-color: rgba(74, 144, 226, 0.1);"
-        "color: #4A90E2;"
-        "}"
-        "QListWidget::item:selected {"
-        "background-color: #4A90E2;"
-        "color: white;"
-        "font-weight: bold;"
-        "}"
-        "QListWidget::item:selected:!active {"
-        "background-color: #4A90E2;"
-        "color: white;"
-        "}"
         );
-    connect(gameHistoryList, &QListWidget::itemClicked, this, &HistoryWindow::onGameSelected);
-    historyLayout->addWidget(gameHistoryList);
+    connect(gameHistoryView, &QListView::clicked, this, &HistoryWindow::onGameSelected);
+
+    emptyHistoryLabel = new QLabel("No games found");
+    emptyHistoryLabel->setAlignment(Qt::AlignCenter);
+    emptyHistoryLabel->setStyleSheet("color: #6c757d; font-size: 14px; font-family: 'Segoe UI', Arial, sans-serif;");
+    emptyHistoryLabel->hide();
+
+    historyLayout->addWidget(gameHistoryView);
+    historyLayout->addWidget(emptyHistoryLabel);
 
     historyContainerLayout->addWidget(historyGroup);
 
@@ -333,29 +440,16 @@ void HistoryWindow::setupUI()
         "}"
         );
 
-    QWidget *boardWidget = new QWidget(boardContainer);
-    boardWidget->setGeometry(15, 15, 320, 320);
-    boardLayout = new QGridLayout(boardWidget);
-    boardLayout->setSpacing(5);
-    boardLayout->setContentsMargins(0, 0, 0, 0);
-
-    for (int i = 0; i < 9; i++) {
-        boardButtons[i] = new QPushButton();
-        boardButtons[i]->setFixedSize(102, 102);
-        boardButtons[i]->setEnabled(false);
-        boardButtons[i]->setStyleSheet(
-            "QPushButton {"
-            "background-color: #ffffff;"
-            "border: 2px solid #4A90E2;"
-            "border-radius: 10px;"
-            "font-size: 42px;"
-            "font-weight: bold;"
-            "font-family: 'Arial', sans-serif;"
-            "color: #495057;"
-            "}"
-            );
-        boardLayout->addWidget(boardButtons[i], i/3, i%3);
-    }
+    // Read-only board; O uses the history window's blue
+    BoardView::Colors boardColors;
+    boardColors.emptyBorder = QColor("#4A90E2");
+    boardColors.oFill = QColor("#4A90E2");
+    boardColors.oBorder = QColor("#3a7bc8");
+
+    boardView = new BoardView(3, boardContainer);
+    boardView->setGeometry(15, 15, 320, 320);
+    boardView->setColors(boardColors);
+    boardView->setInteractive(false);
 
     rightLayout->addWidget(boardTitle);
     rightLayout->addWidget(boardContainer, 0, Qt::AlignCenter);
@@ -434,11 +528,18 @@ void HistoryWindow::setupUI()
     connect(prevButton, &QPushButton::clicked, this, &HistoryWindow::onPreviousMove);
     connect(nextButton, &QPushButton::clicked, this, &HistoryWindow::onNextMove);
 
+    similarButton = new QPushButton("🔍 Similar Games");
+    similarButton->setStyleSheet(buttonStyle);
+    similarButton->setToolTip("Show games that reached the position on the board");
+    similarButton->setEnabled(false);
+    connect(similarButton, &QPushButton::clicked, this, &HistoryWindow::onSimilarGames);
+
     replayControlsLayout->addWidget(prevButton);
     replayControlsLayout->addWidget(playButton);
     replayControlsLayout->addWidget(pauseButton);
     replayControlsLayout->addWidget(stopButton);
     replayControlsLayout->addWidget(nextButton);
+    replayControlsLayout->addWidget(similarButton);
 
     // Move slider
     QHBoxLayout *sliderLayout = new QHBoxLayout();
@@ -517,6 +618,11 @@ void HistoryWindow::setupUI()
     replayLayout->addLayout(sliderLayout);
     replayLayout->addLayout(speedLayout);
 
+    openingLabel = new QLabel();
+    openingLabel->setWordWrap(true);
+    openingLabel->setStyleSheet("color: #2c3e50; font-size: 13px; font-family: 'Segoe UI', Arial, sans-serif;");
+    replayLayout->addWidget(openingLabel);
+
     rightLayout->addWidget(replayGroup);
 
     contentLayout->addWidget(historyContainer);
@@ -592,292 +698,186 @@ void HistoryWindow::onRemoveHistoryClicked()
     // Execute dialog
     msgBox.exec();
 
-    if (msgBox.clickedButton() == deleteButton) {
-        try {
-            if (database->deleteAllGamesForUser(currentUserId)) {
-                // Custom success message
-                QMessageBox successBox(this);
-                successBox.setWindowTitle("✅ Success");
-                successBox.setText("All game history deleted successfully!");
-                successBox.setInformativeText("Your game history has been completely cleared.");
-                successBox.setIcon(QMessageBox::Information);
-                successBox.setStandardButtons(QMessageBox::Ok);
-                successBox.setStyleSheet(
-                    "QMessageBox {"
-                    "background-color: #f8f9fa;"
-                    "}"
-                    "QMessageBox QLabel {"
-                    "color: #28a745;"
-                    "font-size: 14px;"
-                    "font-weight: bold;"
-                    "font-family: 'Segoe UI', Arial, sans-serif;"
-                    "}"
-                    "QPushButton {"
-                    "background-color: #28a745;"
-                    "color: white;"
-                    "border: none;"
-                    "border-radius: 6px;"
-                    "padding: 8px 20px;"
-                    "font-size: 14px;"
-                    "font-weight: bold;"
-                    "min-width: 80px;"
-                    "}"
-                    );
-                successBox.exec();
-
-                // Clear the current display
-                clearBoard();
-                currentMoves.clear();
-
-                // Reload the history (which will now be empty)
-                loadGameHistory();
-                updateStats();
-
-                // Reset replay controls
-                onStopReplay();
-
-            } else {
-                // Error message
-                QMessageBox errorBox(this);
-                errorBox.setWindowTitle("❌ Error");
-                errorBox.setText("Failed to delete game history!");
-                errorBox.setInformativeText("An error occurred while trying to delete your game history. Please try again.");
-                errorBox.setIcon(QMessageBox::Critical);
-                errorBox.setStandardButtons(QMessageBox::Ok);
-                errorBox.setStyleSheet(
-                    "QMessageBox {"
-                    "background-color: #f8f9fa;"
-                    "}"
-                    "QMessageBox QLabel {"
-                    "color: #dc3545;"
-                    "font-size: 14px;"
-                    "font-weight: bold;"
-                    "font-family: 'Segoe UI', Arial, sans-serif;"
-                    "}"
-                    "QPushButton {"
-                    "background-color: #dc3545;"
-                    "color: white;"
-                    "border: none;"
-                    "border-radius: 6px;"
-                    "padding: 8px 20px;"
-                    "font-size: 14px;"
-                    "font-weight: bold;"
-                    "min-width: 80px;"
-                    "}"
-                    );
-                errorBox.exec();
-            }
-        } catch (const std::exception& e) {
-            QMessageBox::critical(this, "Database Error", QString("Database error: %1").arg(e.what()));
-        }
+    if (msgBox.clickedButton() == deleteButton && sessionValid()) {
+        removeHistoryButton->setEnabled(false);
+        historyLoader->requestDeleteAll(currentUserId);
     }
     // If cancel button was clicked, do nothing (dialog just closes)
 }
 
-
-void HistoryWindow::loadGameHistory()
+void HistoryWindow::onPurgeProgress(int gamesDeleted, int gamesTotal)
 {
-    try {
-        gameHistory = database->getGameHistory(currentUserId);
-        gameHistoryList->clear();
-
-        if (gameHistory.empty()) {
-            gameHistoryList->addItem("No games found");
-            return;
-        }
-
-        QString filterText = gameModeFilter->currentText();
-
-        // Handle all filter cases properly
-        for (const auto& game : gameHistory) {
-            QString gameMode = QString::fromStdString(game.gameMode);
-
-            // Apply comprehensive filter logic
-            bool shouldShow = false;
-
-            if (filterText == "All Games") {
-                shouldShow = true;
-            } else if (filterText == "Classic" && gameMode == "Classic") {
-                shouldShow = true;
-            } else if (filterText == "Overwrite" && gameMode == "Overwrite") {
-                shouldShow = true;
-            } else if (filterText == "AI Easy" && gameMode == "AI Easy") {
-                shouldShow = true;
-            } else if (filterText == "AI Medium" && gameMode == "AI Medium") {
-                shouldShow = true;
-            } else if (filterText == "AI Hard" && gameMode == "AI Hard") {
-                shouldShow = true;
-            }
-
-            // Skip this game if it doesn't match the filter
-            if (!shouldShow) continue;
-
-            QString currentUserName = QString::fromStdString(
-                game.player1Id == currentUserId ?
-                    database->getUsernameById(game.player1Id) :
-                    database->getUsernameById(game.player2Id));
-
-            QString opponent;
-
-            // Format opponent name based on game mode
-            if (gameMode.contains("AI")) {
-                QString aiLevel;
-                if (gameMode == "AI Easy") aiLevel = "Easy";
-                else if (gameMode == "AI Medium") aiLevel = "Medium";
-                else if (gameMode == "AI Hard") aiLevel = "Hard";
-                else aiLevel = "AI";
+    // The loading bar turns into a progress bar while a purge runs
+    loadingBar->setRange(0, qMax(gamesTotal, 1));
+    loadingBar->setValue(qMin(gamesDeleted, gamesTotal));
+}
 
-                opponent = QString("%1 vs AI (%2)").arg(currentUserName).arg(aiLevel);
-            } else {
-                opponent = QString("%1 vs Guest (%2)").arg(currentUserName).arg(gameMode);
-            }
+void HistoryWindow::onGamesDeleted(bool success)
+{
+    removeHistoryButton->setEnabled(true);
+    loadingBar->setRange(0, 0);
+
+    if (success) {
+        // Custom success message
+        QMessageBox successBox(this);
+        successBox.setWindowTitle("✅ Success");
+        successBox.setText("All game history deleted successfully!");
+        successBox.setInformativeText("Your game history has been completely cleared.");
+        successBox.setIcon(QMessageBox::Information);
+        successBox.setStandardButtons(QMessageBox::Ok);
+        successBox.setStyleSheet(
+            "QMessageBox {"
+            "background-color: #f8f9fa;"
+            "}"
+            "QMessageBox QLabel {"
+            "color: #28a745;"
+            "font-size: 14px;"
+            "font-weight: bold;"
+            "font-family: 'Segoe UI', Arial, sans-serif;"
+            "}"
+            "QPushButton {"
+            "background-color: #28a745;"
+            "color: white;"
+            "border: none;"
+            "border-radius: 6px;"
+            "padding: 8px 20px;"
+            "font-size: 14px;"
+            "font-weight: bold;"
+            "min-width: 80px;"
+            "}"
+            );
+        successBox.exec();
 
-            QString result;
-            QColor itemColor;
-
-            // Set colors based on game result
-            if (game.winner == 0) {
-                result = "Draw";
-                itemColor = QColor("#fd7e14"); // Orange for draws
-            } else if (game.winner == currentUserId) {
-                result = "Win";
-                itemColor = QColor("#28a745"); // Green for wins
-            } else {
-                result = "Loss";
-                itemColor = QColor("#dc3545"); // Red for losses
-            }
+        // Clear the current display
+        replayTimeline.clear();
+        currentMoveCount = 0;
+        clearBoard();
 
-            QString itemText = QString("%1 - %2 (%3)")
-                                   .arg(opponent)
-                                   .arg(result)
-                                   .arg(QString::fromStdString(game.timestamp).left(10));
+        // Reload the history (which will now be empty)
+        loadGameHistory();
+        updateStats();
 
-            QListWidgetItem *item = new QListWidgetItem(itemText);
-            item->setData(Qt::UserRole, game.id);
+        // Reset replay controls
+        onStopReplay();
+    } else {
+        // Error message
+        QMessageBox errorBox(this);
+        errorBox.setWindowTitle("❌ Error");
+        errorBox.setText("Failed to delete game history!");
+        errorBox.setInformativeText("An error occurred while trying to delete your game history. Please try again.");
+        errorBox.setIcon(QMessageBox::Critical);
+        errorBox.setStandardButtons(QMessageBox::Ok);
+        errorBox.setStyleSheet(
+            "QMessageBox {"
+            "background-color: #f8f9fa;"
+            "}"
+            "QMessageBox QLabel {"
+            "color: #dc3545;"
+            "font-size: 14px;"
+            "font-weight: bold;"
+            "font-family: 'Segoe UI', Arial, sans-serif;"
+            "}"
+            "QPushButton {"
+            "background-color: #dc3545;"
+            "color: white;"
+            "border: none;"
+            "border-radius: 6px;"
+            "padding: 8px 20px;"
+            "font-size: 14px;"
+            "font-weight: bold;"
+            "min-width: 80px;"
+            "}"
+            );
+        errorBox.exec();
+    }
+}
 
-            // Apply the color to the item text
-            item->setForeground(itemColor);
 
-            gameHistoryList->addItem(item);
-        }
+void HistoryWindow::loadGameHistory()
+{
+    // Mode and result filtering happen in SQL; the model pages rows in
+    emptyHistoryLabel->hide();
+    historyModel->setFilter(currentUserId,
+                            gameModeFilter->currentData().toString().toStdString(),
+                            static_cast<TicTacToeDB::ResultFilter>(resultFilter->currentData().toInt()),
+                            positionFilter);
+}
 
-    } catch (const std::exception& e) {
-        QMessageBox::critical(this, "Error", QString("Failed to load history: %1").arg(e.what()));
+void HistoryWindow::onSimilarGames()
+{
+    if (positionFilter != -1) {
+        positionFilter = -1;
+        similarButton->setText("🔍 Similar Games");
+    } else {
+        // Answered from the position index, so symmetric boards match too
+        positionFilter = PositionKey::canonical(replayTimeline.boardAt(currentMoveIndex));
+        similarButton->setText("✖ All Games");
     }
+
+    loadGameHistory();
+    updateReplayControls();
 }
 
 
 void HistoryWindow::onGameSelected()
 {
-    QListWidgetItem *item = gameHistoryList->currentItem();
-    if (!item) return;
-
-    // Ensure the item stays selected
-    item->setSelected(true);
-    gameHistoryList->setCurrentItem(item);
+    QModelIndex index = gameHistoryView->currentIndex();
+    if (!index.isValid()) return;
 
-    int gameId = item->data(Qt::UserRole).toInt();
-
-    for (const auto& game : gameHistory) {
-        if (game.id == gameId) {
-            initializeReplay(game.moves);
-            break;
-        }
+    const TicTacToeDB::GameRecord *game = historyModel->recordAt(index.row());
+    if (game) {
+        currentGameMode = game->gameMode;
+        initializeReplay(game->moveData);
     }
 }
 
-void HistoryWindow::initializeReplay(const std::string& moves)
+void HistoryWindow::initializeReplay(const std::vector<uint8_t>& moveData)
 {
-    currentMoves.clear();
-
-    std::string movesStr = moves;
-    size_t pos = 0;
-    while ((pos = movesStr.find(',')) != std::string::npos) {
-        currentMoves.push_back(movesStr.substr(0, pos));
-        movesStr.erase(0, pos + 1);
-    }
-    if (!movesStr.empty()) {
-        currentMoves.push_back(movesStr);
-    }
+    // Decode once into per-ply boards; seeking is then a lookup
+    replayTimeline.load(MoveCodec::MoveView(moveData));
+    currentMoveCount = replayTimeline.plyCount();
 
     currentMoveIndex = 0;
-    moveSlider->setMaximum(static_cast<int>(currentMoves.size()));
+    moveSlider->setMaximum(currentMoveCount);
     moveSlider->setValue(0);
 
     resetReplay();
+
+    // When browsing similar games, start at the shared position
+    if (positionFilter != -1) {
+        for (int ply = 1; ply <= currentMoveCount; ply++) {
+            if (PositionKey::canonical(replayTimeline.boardAt(ply)) == positionFilter) {
+                currentMoveIndex = ply;
+                displayMoveAtStep(ply);
+                break;
+            }
+        }
+    }
+
     updateReplayControls();
 }
 
 void HistoryWindow::displayMoveAtStep(int step)
 {
-    clearBoard();
-
-    for (size_t i = 0; i < static_cast<size_t>(step) && i < currentMoves.size(); i++) {
-        const std::string& move = currentMoves[i];
-        if (move.length() >= 3) {
-            char player = move[0];
-            int row = move[1] - '0';
-            int col = move[2] - '0';
-            int position = row * 3 + col;
-
-            if (position >= 0 && position < 9) {
-                boardButtons[position]->setText(QString(player));
-                if (player == 'X') {
-                    // Red for X
-                    boardButtons[position]->setStyleSheet(
-                        "QPushButton {"
-                        "background-color: #dc3545;"  // Red background
-                        "border: 3px solid #c82333;"
-                        "border-radius: 10px;"
-                        "font-size: 42px;"
-                        "font-weight: bold;"
-                        "font-family: 'Arial', sans-serif;"
-                        "color: white;"
-                        "text-shadow: 1px 1px 2px rgba(0,0,0,0.3);"
-                        "}"
-                        );
-                } else {
-                    // Green for O
-                    boardButtons[position]->setStyleSheet(
-                        "QPushButton {"
-                        "background-color: #4A90E2;"  // blue background
-                        "border: 3px solid #3a7bc8;"
-                        "border-radius: 10px;"
-                        "font-size: 42px;"
-                        "font-weight: bold;"
-                        "font-family: 'Arial', sans-serif;"
-                        "color: white;"
-                        "text-shadow: 1px 1px 2px rgba(0,0,0,0.3);"
-                        "}"
-                        );
-                }
-            }
-        }
+    // Every ply was precomputed in initializeReplay; only cells that differ
+    // from what is on screen are touched
+    int changedCells[ReplayTimeline::CELLS];
+    int changed = replayTimeline.diff(boardView->cells().data(), step, changedCells);
+    const char* board = replayTimeline.boardAt(step);
+
+    for (int i = 0; i < changed; i++) {
+        boardView->setCell(changedCells[i] / 3, changedCells[i] % 3, board[changedCells[i]]);
     }
 }
 
-
 void HistoryWindow::clearBoard()
 {
-    for (int i = 0; i < 9; i++) {
-        boardButtons[i]->setText("");
-        boardButtons[i]->setStyleSheet(
-            "QPushButton {"
-            "background-color: #ffffff;"
-            "border: 2px solid #4A90E2;"
-            "border-radius: 10px;"
-            "font-size: 42px;"
-            "font-weight: bold;"
-            "font-family: 'Arial', sans-serif;"
-            "color: #495057;"
-            "}"
-            );
-    }
+    boardView->clear();
 }
 
 void HistoryWindow::onPlayReplay()
 {
-    if (currentMoves.empty()) return;
+    if (currentMoveCount == 0) return;
 
     isReplaying = true;
     isPaused = false;
@@ -914,7 +914,7 @@ void HistoryWindow::onStopReplay()
 
 void HistoryWindow::onNextMove()
 {
-    if (currentMoveIndex < static_cast<int>(currentMoves.size())) {
+    if (currentMoveIndex < currentMoveCount) {
         currentMoveIndex++;
         displayMoveAtStep(currentMoveIndex);
         updateReplayControls();
@@ -939,7 +939,7 @@ void HistoryWindow::onSliderChanged(int value)
 
 void HistoryWindow::onReplayStep()
 {
-    if (currentMoveIndex < static_cast<int>(currentMoves.size())) {
+    if (currentMoveIndex < currentMoveCount) {
         currentMoveIndex++;
         displayMoveAtStep(currentMoveIndex);
         updateReplayControls();
@@ -961,10 +961,74 @@ void HistoryWindow::onSpeedChanged(int speed)
 void HistoryWindow::updateReplayControls()
 {
     moveSlider->setValue(currentMoveIndex);
-    moveLabel->setText(QString("Move: %1/%2").arg(currentMoveIndex).arg(static_cast<int>(currentMoves.size())));
+    moveLabel->setText(QString("Move: %1/%2").arg(currentMoveIndex).arg(currentMoveCount));
 
     prevButton->setEnabled(currentMoveIndex > 0);
-    nextButton->setEnabled(currentMoveIndex < static_cast<int>(currentMoves.size()));
+    similarButton->setEnabled(positionFilter != -1 || currentMoveIndex > 0);
+    nextButton->setEnabled(currentMoveIndex < currentMoveCount);
+
+    updateOpenings();
+}
+
+void HistoryWindow::updateOpenings()
+{
+    // Every step asks again; replies for positions already left are dropped
+    openingRequest++;
+    if (currentMoveCount == 0) {
+        openingLabel->clear();
+        return;
+    }
+
+    std::string board(replayTimeline.boardAt(currentMoveIndex), ReplayTimeline::CELLS);
+    historyLoader->requestOpenings(openingRequest, board, currentGameMode);
+}
+
+void HistoryWindow::onOpeningsLoaded(int requestId, const std::vector<TicTacToeDB::OpeningMove>& moves)
+{
+    static const char* CELL_NAMES[ReplayTimeline::CELLS] = {
+        "top-left", "top", "top-right",
+        "left", "center", "right",
+        "bottom-left", "bottom", "bottom-right"
+    };
+
+    if (requestId != openingRequest) {
+        return;
+    }
+
+    if (moves.empty()) {
+        openingLabel->setText("📖 No recorded games continue from this position.");
+        return;
+    }
+
+    // Cells that are equivalent by symmetry come back next to each other with
+    // the same counts; show them as one line
+    char mover = MoveCodec::playerForPly(currentMoveIndex);
+    QStringList lines;
+    size_t i = 0;
+    while (i < moves.size() && lines.size() < 3) {
+        const TicTacToeDB::OpeningMove& move = moves[i];
+        QStringList cells;
+        while (i < moves.size() && moves[i].xWins == move.xWins && moves[i].oWins == move.oWins &&
+               moves[i].draws == move.draws) {
+            cells << CELL_NAMES[moves[i].cell];
+            i++;
+        }
+
+        double games = move.games();
+        int wins = mover == 'X' ? move.xWins : move.oWins;
+        int losses = mover == 'X' ? move.oWins : move.xWins;
+        lines << QString("%1: %2% win · %3% draw · %4% loss (%5 games)")
+                     .arg(cells.join(" / "))
+                     .arg(QString::number(wins * 100.0 / games, 'f', 0))
+                     .arg(QString::number(move.draws * 100.0 / games, 'f', 0))
+                     .arg(QString::number(losses * 100.0 / games, 'f', 0))
+                     .arg(move.games());
+    }
+
+    openingLabel->setText(QString("📖 %1 to move (%2):\n%3")
+                              .arg(QChar(mover))
+                              .arg(QString::fromStdString(currentGameMode))
+                              .arg(lines.join("\n")));
 }
 
 void HistoryWindow::resetReplay()
@@ -987,16 +1051,19 @@ void HistoryWindow::onFilterChanged()
 
 void HistoryWindow::updateStats()
 {
-    try {
-        auto stats = database->getUserStats(currentUserId);
-        QString statsText = QString("Total Games: %1 | Wins: %2 | Losses: %3 | Draws: %4 | Win Rate: %5%")
-                                .arg(stats.totalGames)
-                                .arg(stats.wins)
-                                .arg(stats.losses)
-                                .arg(stats.draws)
-                                .arg(QString::number(stats.winRate, 'f', 1));
-        statsLabel->setText(statsText);
-    } catch (const std::exception& e) {
-        statsLabel->setText("Unable to load statistics");
+    if (currentUserId != -1) {
+        historyLoader->requestStats(currentUserId);
     }
 }
+
+void HistoryWindow::onStatsLoaded(const TicTacToeDB::UserStats& stats)
+{
+    QString statsText = QString("Total Games: %1 | Wins: %2 | Losses: %3 | Draws: %4 | Win Rate: %5% | Rating: %6")
+                            .arg(stats.totalGames)
+                            .arg(stats.wins)
+                            .arg(stats.losses)
+                            .arg(stats.draws)
+                            .arg(QString::number(stats.winRate, 'f', 1))
+                            .arg(QString::number(stats.rating, 'f', 0));
+    statsLabel->setText(statsText);
+}
@@ -4,7 +4,7 @@
 #include <QDialog>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
-#include <QListWidget>
+#include <QListView>
 #include <QTextEdit>
 #include <QPushButton>
 #include <QLabel>
@@ -15,16 +15,31 @@
 #include <QTimer>
 #include <QMessageBox>
 #include <QFrame>
+#include <QProgressBar>
 #include "TicTacToeDB.h"
+#include "MoveCodec.h"
+#include "ReplayTimeline.h"
+#include "BoardView.h"
+#include "GameHistoryModel.h"
+#include "GameHistoryDelegate.h"
+#include "HistoryLoader.h"
 
 class HistoryWindow : public QDialog
 {
     Q_OBJECT
 
 public:
-    HistoryWindow(const QString& username, QWidget *parent = nullptr);
+    explicit HistoryWindow(QWidget *parent = nullptr);
     ~HistoryWindow();
 
+    // Points the dialog at the user holding a SessionStore token and
+    // reloads; the widget tree is kept so MainWindow can reuse one instance
+    // for every visit
+    void setSession(const std::string& token);
+
+public slots:
+    void done(int result) override;
+
 private slots:
     void onGameSelected();
     void onRefreshHistory();
@@ -38,6 +53,15 @@ private slots:
     void onReplayStep();
     void onSpeedChanged(int speed);
     void onRemoveHistoryClicked();
+    void onSimilarGames();
+
+    // Results from HistoryLoader
+    void onStatsLoaded(const TicTacToeDB::UserStats& stats);
+    void onPurgeProgress(int gamesDeleted, int gamesTotal);
+    void onGamesDeleted(bool success);
+    void onOpeningsLoaded(int requestId, const std::vector<TicTacToeDB::OpeningMove>& moves);
+    void onLoaderBusyChanged();
+    void onLoaderFailed(const QString& message);
 
 private:
     QVBoxLayout *mainLayout;
@@ -45,13 +69,15 @@ private:
     QHBoxLayout *filterLayout;
 
     QComboBox *gameModeFilter;
+    QComboBox *resultFilter;
     QGroupBox *historyGroup;
-    QListWidget *gameHistoryList;
+    QListView *gameHistoryView;
+    GameHistoryModel *historyModel;
+    QLabel *emptyHistoryLabel;
     QPushButton *refreshButton;
     QPushButton *removeHistoryButton;
 
-    QGridLayout *boardLayout;
-    QPushButton *boardButtons[9];
+    BoardView *boardView;
 
     // Replay Controls
     QGroupBox *replayGroup;
@@ -61,22 +87,29 @@ private:
     QPushButton *stopButton;
     QPushButton *prevButton;
     QPushButton *nextButton;
+    QPushButton *similarButton;
     QSlider *moveSlider;
     QLabel *moveLabel;
     QSlider *speedSlider;
     QLabel *speedLabel;
+    QLabel *openingLabel; // Outcomes of the moves played from the shown position
 
     QLabel *statsLabel;
+    QProgressBar *loadingBar;
 
-    TicTacToeDB *database;
+    HistoryLoader *historyLoader;
+    std::string sessionToken;
     QString currentUser;
     int currentUserId;
-    std::vector<TicTacToeDB::GameRecord> gameHistory;
 
     // Replay System
     QTimer *replayTimer;
-    std::vector<std::string> currentMoves;
+    ReplayTimeline replayTimeline;
+    int currentMoveCount;
     int currentMoveIndex;
+    int positionFilter; // Canonical key the list is narrowed to, or -1
+    std::string currentGameMode; // Mode of the game being replayed
+    int openingRequest; // Latest requestOpenings id; older replies are dropped
     int replaySpeed;
     bool isReplaying;
     bool isPaused;
@@ -85,11 +118,13 @@ private:
     void loadGameHistory();
     void clearBoard();
     void updateStats();
+    bool sessionValid();
 
     // Replay functions
-    void initializeReplay(const std::string& moves);
+    void initializeReplay(const std::vector<uint8_t>& moveData);
     void displayMoveAtStep(int step);
     void updateReplayControls();
+    void updateOpenings();
     void resetReplay();
 };
 
@@ -1,12 +1,211 @@
 #include <QApplication>
 #include "MainWindow.h"
+#include "Diagnostics.h"
+#include "SelfCheck.h"
+#include "StartupProfiler.h"
+#include "Sha256.h"
+#include "TicTacToeDB.h"
+#include "WriteQueue.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+// Maintenance commands that run without the GUI. Returns the exit code, or
+// -1 if argv holds no command.
+static int runCommand(int argc, char *argv[])
+{
+    if (argc < 2) {
+        return -1;
+    }
+
+    const char *command = argv[1];
+    const char *path = argc > 2 ? argv[2] : nullptr;
+
+    try {
+        if (std::strcmp(command, "--benchmark-sha256") == 0) {
+            Sha256::runBenchmark(std::cout);
+            return 0;
+        }
+
+        if (std::strcmp(command, "--self-check") == 0) {
+            // Storage consistency checks against memory databases only
+            int failed = SelfCheck::run(std::cout);
+            return failed == 0 ? 0 : 1;
+        }
+
+        if (std::strcmp(command, "--recompute-ratings") == 0) {
+            // Rebuild every rating from the stored history
+            TicTacToeDB database;
+            int games = database.recomputeRatings();
+            std::cout << "Ratings recomputed from " << games << " rated games" << std::endl;
+            return 0;
+        }
+
+        if (std::strcmp(command, "--leaderboard") == 0) {
+            // Highest rated players and AI levels, 10 unless given
+            int limit = path ? std::atoi(path) : 10;
+            if (limit <= 0) {
+                std::cerr << "Expected a number of players" << std::endl;
+                return 1;
+            }
+
+            TicTacToeDB database;
+            std::vector<TicTacToeDB::RatingEntry> entries = database.getLeaderboard(limit);
+            for (size_t i = 0; i < entries.size(); i++) {
+                const TicTacToeDB::RatingEntry &entry = entries[i];
+                std::cout << i + 1 << ". " << entry.name << " " << static_cast<int>(entry.rating + 0.5) << " ("
+                          << entry.games << " games: " << entry.wins << " won, " << entry.losses << " lost, "
+                          << entry.draws << " drawn)" << std::endl;
+            }
+            return 0;
+        }
+
+        if (std::strcmp(command, "--archive-older-than") == 0 && path) {
+            // Move games older than N days to the archive database
+            int days = std::atoi(path);
+            if (days <= 0) {
+                std::cerr << "Expected a number of days" << std::endl;
+                return 1;
+            }
+
+            TicTacToeDB database;
+            int total = 0;
+            int moved;
+            while ((moved = database.archiveGamesOlderThan(days)) > 0) {
+                total += moved;
+            }
+            std::cout << "Archived " << total << " games" << std::endl;
+            return 0;
+        }
+
+        if (std::strcmp(command, "--export-rollups") == 0 && path) {
+            // Per-mode report from the rollup tables: hour, day (default) or month
+            const char *grain = argc > 3 ? argv[3] : "day";
+            TicTacToeDB::RollupQuery query;
+            if (std::strcmp(grain, "hour") == 0) {
+                query.grain = TicTacToeDB::HOURLY;
+            } else if (std::strcmp(grain, "month") == 0) {
+                query.grain = TicTacToeDB::MONTHLY;
+            } else if (std::strcmp(grain, "day") != 0) {
+                std::cerr << "Expected hour, day or month" << std::endl;
+                return 1;
+            }
+
+            std::ofstream out(path, std::ios::binary);
+            if (!out) {
+                std::cerr << "Cannot create " << path << std::endl;
+                return 1;
+            }
+
+            TicTacToeDB database;
+            int rows = database.exportRollupsCsv(query, out);
+            std::cout << "Exported " << rows << " rows" << std::endl;
+            return 0;
+        }
+
+        if (std::strcmp(command, "--purge-user") == 0 && path) {
+            // Deletes the account and every game it played in, in chunks
+            TicTacToeDB database;
+            int userId = database.getUserId(path);
+            if (userId == -1) {
+                std::cerr << "No user named " << path << std::endl;
+                return 1;
+            }
+
+            TicTacToeDB::PurgeProgress progress = database.startPurge(userId, true);
+            while (!progress.finished) {
+                std::cout << "\rDeleted " << progress.gamesDeleted << " of " << progress.gamesTotal << " games"
+                          << std::flush;
+                progress = database.purgeStep(userId);
+            }
+            while (database.resumeRatingRebuild()) {
+            }
+            std::cout << "\rDeleted " << progress.gamesDeleted << " games and user " << path << std::endl;
+            return 0;
+        }
+
+        if (std::strcmp(command, "--vacuum") == 0) {
+            // Full rebuild of both files; the game must not be running
+            TicTacToeDB database;
+            long long reclaimed = database.vacuum();
+            std::cout << "Reclaimed " << reclaimed / 1024 << " KB" << std::endl;
+            return 0;
+        }
+
+        if (std::strcmp(command, "--backup") == 0 && path) {
+            // Consistent copy of the database and its archive, safe while
+            // the game is running
+            TicTacToeDB database;
+            database.backupTo(path);
+            std::cout << "Backed up to " << path << " and " << TicTacToeDB::archiveLocation(path) << std::endl;
+            return 0;
+        }
+
+        if (std::strcmp(command, "--export-archive") == 0 && path) {
+            std::ofstream out(path, std::ios::binary);
+            if (!out) {
+                std::cerr << "Cannot create " << path << std::endl;
+                return 1;
+            }
+
+            TicTacToeDB database;
+            TicTacToeDB::ArchiveStats stats = database.exportArchive(out);
+            std::cout << "Exported " << stats.users << " users and " << stats.games << " games" << std::endl;
+            return 0;
+        }
+
+        if (std::strcmp(command, "--import-archive") == 0 && path) {
+            std::ifstream in(path, std::ios::binary);
+            if (!in) {
+                std::cerr << "Cannot open " << path << std::endl;
+                return 1;
+            }
+
+            TicTacToeDB database;
+            TicTacToeDB::ArchiveStats stats = database.importArchive(in);
+            std::cout << "Imported " << stats.users << " users and " << stats.games << " games ("
+                      << stats.duplicates << " duplicates, " << stats.rejected << " rejected)" << std::endl;
+            return 0;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << command << " failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return -1;
+}
 
 int main(int argc, char *argv[])
 {
+    int commandResult = runCommand(argc, argv);
+    if (commandResult != -1) {
+        return commandResult;
+    }
+
+    // Starts the startup clock; MainWindow prints the breakdown if
+    // $TICTACTOE_STARTUP_TIMINGS is set
+    StartupProfiler *profiler = StartupProfiler::getInstance();
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--diagnostics") == 0) {
+            Diagnostics::enable();
+        }
+    }
+
     QApplication app(argc, argv);
+    profiler->mark("QApplication");
 
     MainWindow window;
+    profiler->mark("login screen");
+
     window.show();
+    profiler->mark("show");
+
+    int result = app.exec();
 
-    return app.exec();
+    // How much the connections had to wait for each other this run
+    if (Diagnostics::enabled()) {
+        WriteQueue::getInstance()->report(std::cerr);
+    }
+    return result;
 }
@@ -3,15 +3,29 @@
 #include <QFont>
 #include <QScreen>
 #include <QGuiApplication>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QShowEvent>
+#include <QWindow>
+#include <iostream>
+#include "GameHistoryManager.h"
+#include "PasswordHasher.h"
+#include "SessionStore.h"
+#include "StartupProfiler.h"
+
+// Time one password hash should take on this machine
+static const int PASSWORD_HASH_TARGET_MS = 250;
 
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), database(nullptr), currentUserId(-1), isLoggedIn(false)
+    : QMainWindow(parent), mainMenuWidget(nullptr), aiMenuWidget(nullptr), historyWindow(nullptr),
+    databaseThread(nullptr), backfillThread(nullptr), stopBackfill(false), startupStepsLeft(2), firstFrameSeen(false), database(nullptr), currentUserId(-1), isLoggedIn(false)
 {
-    try {
-        database = new TicTacToeDB();
-    } catch (const std::exception& e) {
-        QMessageBox::critical(this, "Database Error", e.what());
-    }
+    // Logins and registrations only overlap if they come from different
+    // windows, but a hash must never wait behind another for long
+    credentialPool.setMaxThreadCount(2);
+
+    // Schema checks run while the login screen paints
+    openDatabaseAsync();
 
     setupUI();
     applyModernStyling();
@@ -20,17 +34,234 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    // Results of running hashes are dropped, but the jobs must finish first
+    credentialPool.waitForDone();
+
+    // Pooled game windows are top-level, so they are not deleted with us
+    for (GameWindow *gameWindow : gameWindowPool) {
+        delete gameWindow;
+    }
+
+    maintenance.stop();
+
+    if (backfillThread) {
+        stopBackfill = true;
+        backfillThread->wait();
+        delete backfillThread;
+    }
+
+    if (databaseThread) {
+        databaseThread->wait();
+        delete databaseThread;
+    }
     delete database;
 }
 
+void MainWindow::openDatabaseAsync()
+{
+    databaseThread = QThread::create([this]() {
+        StartupProfiler *profiler = StartupProfiler::getInstance();
+        qint64 start = profiler->elapsed();
+
+        try {
+            database = new TicTacToeDB();
+        } catch (const std::exception& e) {
+            databaseError = e.what();
+        }
+        profiler->record("database open + schema (background)", start, profiler->elapsed() - start);
+
+        start = profiler->elapsed();
+        int cost = PasswordHasher::calibrate(PASSWORD_HASH_TARGET_MS);
+        if (database) {
+            try {
+                cost = database->raisePasswordCost(cost);
+            } catch (const std::exception& e) {
+                std::cerr << "Failed to store password cost: " << e.what() << std::endl;
+            }
+        }
+        PasswordHasher::setIterations(cost);
+        profiler->record("password cost calibration (background)", start, profiler->elapsed() - start);
+
+        // The history recorder keeps its own connection; open it here too so
+        // the first game doesn't pay for it
+        start = profiler->elapsed();
+        GameHistoryManager::getInstance();
+        profiler->record("history recorder (background)", start, profiler->elapsed() - start);
+
+        // Games a crash or power cut left unfinished
+        start = profiler->elapsed();
+        recoveredGames = GameJournal::recover();
+        profiler->record("journal recovery (background)", start, profiler->elapsed() - start);
+    });
+
+    connect(databaseThread, &QThread::finished, this, &MainWindow::onDatabaseReady);
+    databaseThread->start();
+}
+
+bool MainWindow::waitForDatabase()
+{
+    // Only blocks if the user is faster than the startup thread
+    if (databaseThread && !databaseThread->isFinished()) {
+        databaseThread->wait();
+    }
+
+    if (!database) {
+        QMessageBox::critical(this, "Database Error",
+                              databaseError.isEmpty() ? "Database is not available." : databaseError);
+        return false;
+    }
+    return true;
+}
+
+void MainWindow::onDatabaseReady()
+{
+    if (!database) {
+        QMessageBox::critical(this, "Database Error", databaseError);
+    } else {
+        // Only recent games are worth offering at login; older ones are
+        // stored as abandoned right away
+        QDateTime cutoff = QDateTime::currentDateTime().addDays(-1);
+        for (auto it = recoveredGames.begin(); it != recoveredGames.end();) {
+            if (it->lastWritten < cutoff && abandonRecoveredGame(*it)) {
+                it = recoveredGames.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        startIndexBackfill();
+        maintenance.start();
+    }
+    startupStepFinished();
+}
+
+void MainWindow::startIndexBackfill()
+{
+    // Own connection, small batches and a pause between them, so games saved
+    // meanwhile only ever wait for one short transaction. Purges and rating
+    // rebuilds a previous run left unfinished are completed the same way.
+    backfillThread = QThread::create([this]() {
+        try {
+            TicTacToeDB indexDatabase;
+            while (!stopBackfill) {
+                int indexed = indexDatabase.resumePurges() + indexDatabase.resumeRatingRebuild() +
+                              indexDatabase.backfillPositions(500) + indexDatabase.backfillOpenings(500);
+                if (indexed == 0) {
+                    break;
+                }
+                QThread::msleep(20);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Index backfill stopped: " << e.what() << std::endl;
+        }
+    });
+    backfillThread->setObjectName("IndexBackfill");
+    backfillThread->start(QThread::LowPriority);
+}
+
+void MainWindow::offerRecoveredGame()
+{
+    // Newest interrupted game of this user; any older ones are abandoned
+    auto latest = recoveredGames.end();
+    for (auto it = recoveredGames.begin(); it != recoveredGames.end(); ++it) {
+        if (it->player1Id == currentUserId &&
+            (latest == recoveredGames.end() || it->lastWritten > latest->lastWritten)) {
+            latest = it;
+        }
+    }
+    if (latest == recoveredGames.end()) {
+        return;
+    }
+
+    GameJournal::RecoveredGame game = *latest;
+    recoveredGames.erase(latest);
+
+    for (auto it = recoveredGames.begin(); it != recoveredGames.end();) {
+        if (it->player1Id == currentUserId && abandonRecoveredGame(*it)) {
+            it = recoveredGames.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    QMessageBox::StandardButton answer = QMessageBox::question(
+        this, "Resume Game",
+        QString("Your %1 game from %2 was interrupted after %3 moves.\nDo you want to resume it?")
+            .arg(QString::fromStdString(game.gameMode))
+            .arg(game.lastWritten.toString("yyyy-MM-dd hh:mm"))
+            .arg(game.plyCount));
+
+    if (answer != QMessageBox::Yes) {
+        abandonRecoveredGame(game);
+        return;
+    }
+
+    this->hide();
+
+    // The resumed game journals into a new file, so the old one can go
+    GameWindow *gameWindow = acquireGameWindow();
+    gameWindow->configure(QString::fromStdString(game.gameMode), sessionToken, QString(), game.player2Id);
+    gameWindow->show();
+    gameWindow->resumeGame(MoveCodec::MoveView(game.moveData));
+    GameJournal::remove(game.path);
+}
+
+bool MainWindow::abandonRecoveredGame(const GameJournal::RecoveredGame& game)
+{
+    try {
+        database->saveAbandonedGame(game.player1Id, game.player2Id, game.moveData, game.plyCount, game.gameMode,
+                                    game.lastWritten.toUTC().toString("yyyy-MM-dd HH:mm:ss").toStdString());
+        GameJournal::remove(game.path);
+        return true;
+    } catch (const std::exception& e) {
+        // Journal stays on disk and is tried again next start
+        std::cerr << "Failed to store abandoned game: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void MainWindow::showEvent(QShowEvent *event)
+{
+    QMainWindow::showEvent(event);
+
+    // The first frame is timed from the window's first expose
+    if (!firstFrameSeen && windowHandle()) {
+        windowHandle()->installEventFilter(this);
+    }
+}
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    if (!firstFrameSeen && watched == windowHandle() && event->type() == QEvent::Expose &&
+        windowHandle()->isExposed()) {
+        firstFrameSeen = true;
+        watched->removeEventFilter(this);
+
+        // Handling the expose paints the login screen and flushes it to the
+        // window; this is queued behind it, so it runs once that is done
+        QTimer::singleShot(0, this, [this]() {
+            StartupProfiler::getInstance()->mark("first frame");
+            startupStepFinished();
+        });
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::startupStepFinished()
+{
+    // Both the first frame and the database thread are done
+    if (--startupStepsLeft == 0) {
+        StartupProfiler::getInstance()->report();
+    }
+}
+
 void MainWindow::setupUI()
 {
     stackedWidget = new QStackedWidget(this);
     setCentralWidget(stackedWidget);
 
+    // Main and AI menus are built on first use
     setupLoginMenu();
-    setupMainMenu();
-    setupAIMenu();
 
     setWindowTitle("Tic Tac Toe - Professional Edition");
     setFixedSize(500, 700);
@@ -132,34 +363,8 @@ void MainWindow::setupLoginMenu()
     loginLayout->addWidget(loginButtonFrame, 2); // Same proportion as game window
 
     // Connect login signals (keep your existing connections)
-    connect(loginBtn, &QPushButton::clicked, this, [this]() {
-        if (authenticateUser()) {
-            showMainMenu();
-        }
-    });
-
-    connect(registerBtn, &QPushButton::clicked, this, [this]() {
-        bool ok;
-        QString username = QInputDialog::getText(this, "Register", "Enter username:", QLineEdit::Normal, "", &ok);
-        if (!ok || username.isEmpty()) return;
-
-        QString password = QInputDialog::getText(this, "Register", "Enter password:", QLineEdit::Password, "", &ok);
-        if (!ok || password.isEmpty()) return;
-
-        try {
-            if (database->createUser(username.toStdString(), password.toStdString())) {
-                QMessageBox::information(this, "Success", "Account created successfully!");
-                currentUsername = username;
-                currentUserId = database->getUserId(username.toStdString());
-                isLoggedIn = true;
-                showMainMenu();
-            } else {
-                QMessageBox::warning(this, "Error", "Failed to create account. Username might already exist.");
-            }
-        } catch (const std::exception& e) {
-            QMessageBox::critical(this, "Error", e.what());
-        }
-    });
+    connect(loginBtn, &QPushButton::clicked, this, &MainWindow::authenticateUser);
+    connect(registerBtn, &QPushButton::clicked, this, &MainWindow::registerUser);
 
     connect(guestBtn, &QPushButton::clicked, this, [this]() {
         currentUsername = "Guest";
@@ -412,34 +617,142 @@ void MainWindow::applyModernStyling()
         );
 }
 
-bool MainWindow::authenticateUser()
+void MainWindow::authenticateUser()
 {
     bool ok;
     QString username = QInputDialog::getText(this, "Login", "Enter username:", QLineEdit::Normal, "", &ok);
-    if (!ok || username.isEmpty()) return false;
+    if (!ok || username.isEmpty()) return;
 
     QString password = QInputDialog::getText(this, "Login", "Enter password:", QLineEdit::Password, "", &ok);
-    if (!ok || password.isEmpty()) return false;
+    if (!ok || password.isEmpty()) return;
 
-    try {
-        if (database->validateUser(username.toStdString(), password.toStdString())) {
-            currentUsername = username;
-            currentUserId = database->getUserId(username.toStdString());
-            isLoggedIn = true;
-            return true;
-        } else {
-            QMessageBox::warning(this, "Login Failed", "Invalid username or password.");
-            return false;
+    if (!waitForDatabase()) return;
+
+    // Unknown names are checked against a placeholder at the same cost, so
+    // the response time doesn't reveal which usernames exist
+    int userId = -1;
+    std::string storedHash;
+    if (!database->getPasswordHash(username.toStdString(), userId, storedHash)) {
+        userId = -1;
+        storedHash = PasswordHasher::placeholderHash();
+    }
+
+    setCredentialsBusy(true);
+    std::string plain = password.toStdString();
+    credentialPool.start([this, username, userId, storedHash, plain]() {
+        bool valid = PasswordHasher::verify(plain, storedHash) && userId != -1;
+        std::string upgradedHash;
+        if (valid && PasswordHasher::needsRehash(storedHash)) {
+            upgradedHash = PasswordHasher::hash(plain);
         }
-    } catch (const std::exception& e) {
-        QMessageBox::critical(this, "Error", e.what());
-        return false;
+
+        QMetaObject::invokeMethod(this, [=]() {
+            finishLogin(username, userId, valid, storedHash, upgradedHash);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::finishLogin(const QString &username, int userId, bool valid, const std::string &storedHash,
+                             const std::string &upgradedHash)
+{
+    setCredentialsBusy(false);
+
+    if (!valid) {
+        QMessageBox::warning(this, "Login Failed", "Invalid username or password.");
+        return;
+    }
+
+    // A failed upgrade only means the old hash stays until the next login
+    if (!upgradedHash.empty()) {
+        database->replacePasswordHash(userId, storedHash, upgradedHash);
+    }
+
+    beginSession(username, userId);
+    showMainMenu();
+    offerRecoveredGame();
+}
+
+void MainWindow::registerUser()
+{
+    bool ok;
+    QString username = QInputDialog::getText(this, "Register", "Enter username:", QLineEdit::Normal, "", &ok);
+    if (!ok || username.isEmpty()) return;
+
+    QString password = QInputDialog::getText(this, "Register", "Enter password:", QLineEdit::Password, "", &ok);
+    if (!ok || password.isEmpty()) return;
+
+    if (!waitForDatabase()) return;
+
+    // Cheap checks first; the hash is only worth computing for a valid name
+    if (!TicTacToeDB::acceptableCredentials(username.toStdString(), password.toStdString()) ||
+        database->userExists(username.toStdString())) {
+        QMessageBox::warning(this, "Error", "Failed to create account. Username might already exist.");
+        return;
+    }
+
+    setCredentialsBusy(true);
+    std::string plain = password.toStdString();
+    credentialPool.start([this, username, plain]() {
+        std::string passwordHash = PasswordHasher::hash(plain);
+
+        QMetaObject::invokeMethod(this, [this, username, passwordHash]() {
+            setCredentialsBusy(false);
+            try {
+                if (database->createUserWithHash(username.toStdString(), passwordHash)) {
+                    QMessageBox::information(this, "Success", "Account created successfully!");
+                    beginSession(username, database->getUserId(username.toStdString()));
+                    showMainMenu();
+                } else {
+                    QMessageBox::warning(this, "Error", "Failed to create account. Username might already exist.");
+                }
+            } catch (const std::exception& e) {
+                QMessageBox::critical(this, "Error", e.what());
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::setCredentialsBusy(bool busy)
+{
+    // The window keeps painting while a hash runs; only a second login or
+    // registration is held off until it finishes
+    loginBtn->setEnabled(!busy);
+    registerBtn->setEnabled(!busy);
+    guestBtn->setEnabled(!busy);
+
+    if (busy) {
+        QApplication::setOverrideCursor(Qt::BusyCursor);
+    } else {
+        QApplication::restoreOverrideCursor();
     }
 }
 
+void MainWindow::beginSession(const QString &username, int userId)
+{
+    // Everything after login identifies the user through this token
+    sessionToken = SessionStore::getInstance()->open(userId, username.toStdString());
+    currentUsername = username;
+    currentUserId = userId;
+    isLoggedIn = true;
+}
+
+bool MainWindow::checkSession()
+{
+    SessionStore::Session session;
+    if (!isLoggedIn || SessionStore::getInstance()->lookup(sessionToken, session)) {
+        return true;
+    }
+
+    QMessageBox::information(this, "Session Expired", "Your session has expired. Please log in again.");
+    showLogin();
+    return false;
+}
+
 // Slot implementations
 void MainWindow::showLogin()
 {
+    SessionStore::getInstance()->close(sessionToken);
+    sessionToken.clear();
     currentUsername = "";
     currentUserId = -1;
     isLoggedIn = false;
@@ -448,77 +761,76 @@ void MainWindow::showLogin()
 
 void MainWindow::showMainMenu()
 {
+    if (!mainMenuWidget) {
+        setupMainMenu();
+    }
+
     userLabel->setText("Welcome, " + currentUsername + "!");
     stackedWidget->setCurrentWidget(mainMenuWidget);
+
+    // Build the first game window while the menu is idle
+    if (gameWindowPool.empty()) {
+        QTimer::singleShot(0, this, [this]() { acquireGameWindow(); });
+    }
 }
 
-void MainWindow::startClassicGame()
+GameWindow* MainWindow::acquireGameWindow()
 {
-    this->hide();
-
-    GameWindow *gameWindow = new GameWindow("Classic Mode", nullptr);
-    gameWindow->setAttribute(Qt::WA_DeleteOnClose);
-    gameWindow->setCurrentUser(currentUsername, currentUserId);
-
-    connect(gameWindow, &QWidget::destroyed, this, &QWidget::show);
+    for (GameWindow *gameWindow : gameWindowPool) {
+        if (gameWindow->isHidden()) {
+            return gameWindow;
+        }
+    }
 
-    gameWindow->show();
+    // Built once; later games only reset it
+    GameWindow *gameWindow = new GameWindow(nullptr);
+    connect(gameWindow, &GameWindow::closed, this, &QWidget::show);
+    gameWindowPool.push_back(gameWindow);
+    return gameWindow;
 }
 
-void MainWindow::startOverwriteGame()
+void MainWindow::startGame(const QString &gameMode)
 {
-    this->hide();
+    if (!checkSession()) return;
 
-    GameWindow *gameWindow = new GameWindow("Overwrite Mode", nullptr);
-    gameWindow->setAttribute(Qt::WA_DeleteOnClose);
-    gameWindow->setCurrentUser(currentUsername, currentUserId);
-
-    connect(gameWindow, &QWidget::destroyed, this, &QWidget::show);
+    this->hide();
 
+    GameWindow *gameWindow = acquireGameWindow();
+    gameWindow->configure(gameMode, sessionToken);
     gameWindow->show();
 }
 
-void MainWindow::startEasyAI()
+void MainWindow::startClassicGame()
 {
-    this->hide();
-
-    GameWindow *gameWindow = new GameWindow("AI Easy", nullptr);
-    gameWindow->setAttribute(Qt::WA_DeleteOnClose);
-    gameWindow->setCurrentUser(currentUsername, currentUserId);
+    startGame("Classic Mode");
+}
 
-    connect(gameWindow, &QWidget::destroyed, this, &QWidget::show);
+void MainWindow::startOverwriteGame()
+{
+    startGame("Overwrite Mode");
+}
 
-    gameWindow->show();
+void MainWindow::startEasyAI()
+{
+    startGame("AI Easy");
 }
 
 void MainWindow::startMediumAI()
 {
-    this->hide();
-
-    GameWindow *gameWindow = new GameWindow("AI Medium", nullptr);
-    gameWindow->setAttribute(Qt::WA_DeleteOnClose);
-    gameWindow->setCurrentUser(currentUsername, currentUserId);
-
-    connect(gameWindow, &QWidget::destroyed, this, &QWidget::show);
-
-    gameWindow->show();
+    startGame("AI Medium");
 }
 
 void MainWindow::startHardAI()
 {
-    this->hide();
-
-    GameWindow *gameWindow = new GameWindow("AI Hard", nullptr);
-    gameWindow->setAttribute(Qt::WA_DeleteOnClose);
-    gameWindow->setCurrentUser(currentUsername, currentUserId);
-
-    connect(gameWindow, &QWidget::destroyed, this, &QWidget::show);
-
-    gameWindow->show();
+    startGame("AI Hard");
 }
 
 void MainWindow::showAIMenu()
 {
+    if (!aiMenuWidget) {
+        setupAIMenu();
+    }
+
     stackedWidget->setCurrentWidget(aiMenuWidget);
 }
 
@@ -528,8 +840,13 @@ void MainWindow::showGameHistory()
         QMessageBox::information(this, "Login Required", "Please login to view game history.");
         return;
     }
+    if (!checkSession()) return;
+
+    // Created on first use and reused for every later visit
+    if (!historyWindow) {
+        historyWindow = new HistoryWindow(this);
+    }
 
-    HistoryWindow *historyWindow = new HistoryWindow(currentUsername, this);
-    historyWindow->setAttribute(Qt::WA_DeleteOnClose);
+    historyWindow->setSession(sessionToken);
     historyWindow->exec();
 }
@@ -13,6 +13,10 @@
 #include <QColor>
 #include <QMessageBox>
 #include <QInputDialog>
+#include <QThread>
+#include <QThreadPool>
+#include <vector>
+#include <atomic>
 
 // Include game modules
 #include "classic_game.h"
@@ -21,6 +25,8 @@
 #include "GameWindow.h"
 #include "HistoryWindow.h"
 #include "TicTacToeDB.h"
+#include "GameJournal.h"
+#include "MaintenanceScheduler.h"
 
 class MainWindow : public QMainWindow
 {
@@ -40,6 +46,11 @@ private slots:
     void startHardAI();
     void showGameHistory();
     void showLogin();
+    void onDatabaseReady();
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 private:
     void setupUI();
@@ -49,7 +60,21 @@ private:
     void applyModernStyling();
     QPushButton* createStyledButton(const QString &text, const QString &color);
     void addButtonAnimation(QPushButton *button);
-    bool authenticateUser();
+    void authenticateUser();
+    void registerUser();
+    void finishLogin(const QString &username, int userId, bool valid, const std::string &storedHash,
+                     const std::string &upgradedHash);
+    void setCredentialsBusy(bool busy);
+    void beginSession(const QString &username, int userId);
+    bool checkSession();
+    void openDatabaseAsync();
+    bool waitForDatabase();
+    void startupStepFinished();
+    void offerRecoveredGame();
+    void startIndexBackfill();
+    bool abandonRecoveredGame(const GameJournal::RecoveredGame& game);
+    void startGame(const QString &gameMode);
+    GameWindow* acquireGameWindow();
 
     QStackedWidget *stackedWidget;
     QWidget *mainMenuWidget;
@@ -86,11 +111,25 @@ private:
     QPushButton *hardAIBtn;
     QPushButton *backToMainBtn;
 
+    // Game windows are kept after closing and reconfigured for the next game
+    std::vector<GameWindow*> gameWindowPool;
+    HistoryWindow *historyWindow;
+
     // User management
+    QThread *databaseThread; // Opens database off the GUI thread at startup
+    QString databaseError;
+    std::vector<GameJournal::RecoveredGame> recoveredGames; // Found by the startup thread
+    QThread *backfillThread; // Indexes games saved before the position index and opening tree
+    std::atomic<bool> stopBackfill;
+    QThreadPool credentialPool; // Password hashing and verification
+    MaintenanceScheduler maintenance; // Vacuum, optimize and checkpoints while idle
+    int startupStepsLeft;
+    bool firstFrameSeen;
     TicTacToeDB *database;
     QString currentUsername;
     int currentUserId;
     bool isLoggedIn;
+    std::string sessionToken; // SessionStore token of the logged in user; empty for guests
 };
 
 #endif